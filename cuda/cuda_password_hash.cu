@@ -19,13 +19,17 @@
 #include <stdlib.h>
 #include <string.h>
 #include <cuda_runtime.h>
+#include <openssl/md4.h>
 #include <openssl/md5.h>
 #include "md5_device.cuh"
+#include "md4_device.cuh"
 
 // Configuration - ADJUSTABLE LIMITS
 #define CHARSET "abcdefghijklmnopqrstuvwxyz"
 #define CHARSET_SIZE 26
 #define MAX_PASSWORD_LENGTH 10  // Can increase to 15+ if needed (memory allows up to 55)
+#define MAX_PASSPHRASE_LENGTH 119  // Two MD5 blocks minus padding and length
+#define MAX_NTLM_PASSPHRASE_LENGTH 59  // Two MD4 blocks of UTF-16LE
 
 // Warning thresholds for time estimation
 #define WARN_THRESHOLD_COMBINATIONS 100000000000ULL  // 100 billion (>25 seconds)
@@ -155,6 +159,110 @@ __global__ void crack_password_kernel(
     }
 }
 
+/*
+ * DEVICE FUNCTION: Write one byte into a little-endian MD5 message buffer
+ */
+__device__ void set_md5_byte(unsigned int* buffer, int position, unsigned char value) {
+    buffer[position / 4] |= ((unsigned int)value) << ((position % 4) * 8);
+}
+
+/*
+ * CUDA KERNEL: Long Passphrase Cracking (up to two MD5 or MD4 blocks)
+ * 
+ * The known leading part of the passphrase, the 0x80 padding byte and the
+ * bit length are laid out once on the host in `message_template`. Each
+ * candidate only ORs its brute-forced suffix into a copy of the template.
+ * For NTLM the template holds UTF-16LE, so each suffix character goes to
+ * every other byte and the block is compressed with MD4.
+ * 
+ * When the known part fills the whole first block, the host passes the
+ * compression state after that block in `first_block_state` and the kernel
+ * only compresses the second block per candidate.
+ */
+__global__ void crack_passphrase_kernel(
+    unsigned long long passwords_per_thread,
+    const unsigned int* message_template,     // 16 or 32 words, pre-padded
+    int prefix_length,                         // Known leading characters
+    int suffix_length,                         // Brute-forced trailing characters
+    int message_blocks,                        // 1 or 2
+    int ntlm,                                  // MD4 over UTF-16LE instead of MD5
+    const unsigned int* first_block_state,     // Cached state, or NULL
+    unsigned int* target_hash,
+    int* found_flag,
+    char* result_suffix,
+    unsigned long long* found_at_index,
+    unsigned long long total_combinations
+) {
+    unsigned long long thread_id = blockIdx.x * blockDim.x + threadIdx.x;
+    unsigned long long my_start = thread_id * passwords_per_thread;
+
+    if (my_start >= total_combinations) return;
+
+    // With a cached first block only the second block is rebuilt and hashed
+    int first_block = first_block_state ? 1 : 0;
+    int words = (message_blocks - first_block) * 16;
+    int width = ntlm ? 2 : 1;
+    int offset = prefix_length * width - first_block * 64;
+
+    char suffix[MAX_PASSWORD_LENGTH + 1];
+    unsigned int message[32];
+    unsigned int state[4];
+
+    for (unsigned long long i = 0; i < passwords_per_thread; i++) {
+        if (*found_flag) {
+            return;
+        }
+
+        unsigned long long current_index = my_start + i;
+        if (current_index >= total_combinations) {
+            return;
+        }
+
+        index_to_password(current_index, suffix, suffix_length);
+
+        for (int w = 0; w < words; w++) {
+            message[w] = message_template[first_block * 16 + w];
+        }
+        for (int j = 0; j < suffix_length; j++) {
+            set_md5_byte(message, offset + j * width, suffix[j]);
+        }
+
+        if (first_block) {
+            state[0] = first_block_state[0];
+            state[1] = first_block_state[1];
+            state[2] = first_block_state[2];
+            state[3] = first_block_state[3];
+        } else {
+            state[0] = MD5_INIT_A;
+            state[1] = MD5_INIT_B;
+            state[2] = MD5_INIT_C;
+            state[3] = MD5_INIT_D;
+        }
+        for (int b = 0; b < words / 16; b++) {
+            if (ntlm) {
+                md4_cuda_transform(message + b * 16, state);
+            } else {
+                md5_cuda_transform(message + b * 16, state);
+            }
+        }
+
+        if (state[0] == target_hash[0] && 
+            state[1] == target_hash[1] &&
+            state[2] == target_hash[2] && 
+            state[3] == target_hash[3]) {
+
+            int old = atomicCAS(found_flag, 0, 1);
+            if (old == 0) {
+                *found_at_index = current_index;
+                for (int j = 0; j <= suffix_length; j++) {
+                    result_suffix[j] = suffix[j];
+                }
+            }
+            return;
+        }
+    }
+}
+
 /*
  * HOST FUNCTION: Compute MD5 hash on CPU using OpenSSL
  * This is a one-time operation to generate the target hash
@@ -340,6 +448,173 @@ int crack_password_cuda(const char* target_password, int password_length, int th
     return found;
 }
 
+/*
+ * HOST FUNCTION: Long passphrase cracking orchestrator
+ * 
+ * Brute-forces the last `suffix_length` characters of a passphrase of up to
+ * 119 bytes (59 ASCII characters for NTLM, which hashes two bytes each).
+ * Lays out the known part and padding once, and caches the first block's
+ * compression state when the known part covers it.
+ */
+int crack_passphrase_cuda(const char* target_passphrase, int suffix_length, int threads_per_block,
+                          int ntlm) {
+    int length = strlen(target_passphrase);
+    int prefix_length = length - suffix_length;
+    int width = ntlm ? 2 : 1;
+    int message_bytes = length * width;
+    int message_blocks = (message_bytes + 8) / 64 + 1;   // 1 block up to 55 bytes, else 2
+
+    unsigned long long total_combinations = 1;
+    for (int i = 0; i < suffix_length; i++) {
+        total_combinations *= CHARSET_SIZE;
+    }
+
+    // Lay out known prefix, padding and bit length (little-endian words);
+    // NTLM widens each character to UTF-16LE
+    unsigned int message_template[32];
+    memset(message_template, 0, sizeof(message_template));
+    unsigned char* template_bytes = (unsigned char*)message_template;
+    for (int i = 0; i < prefix_length; i++) {
+        template_bytes[i * width] = target_passphrase[i];
+    }
+    template_bytes[message_bytes] = 0x80;
+    message_template[message_blocks * 16 - 2] = message_bytes * 8;
+
+    // Cache the first block's state when every candidate shares it
+    int cache_first_block = (message_blocks == 2 && prefix_length * width >= 64);
+    unsigned int first_block_state[4];
+    if (cache_first_block && ntlm) {
+        MD4_CTX ctx;
+        MD4_Init(&ctx);
+        MD4_Update(&ctx, template_bytes, 64);      // exactly one block: ctx holds the state
+        first_block_state[0] = ctx.A;
+        first_block_state[1] = ctx.B;
+        first_block_state[2] = ctx.C;
+        first_block_state[3] = ctx.D;
+    } else if (cache_first_block) {
+        MD5_CTX ctx;
+        MD5_Init(&ctx);
+        MD5_Update(&ctx, target_passphrase, 64);   // exactly one block: ctx holds the state
+        first_block_state[0] = ctx.A;
+        first_block_state[1] = ctx.B;
+        first_block_state[2] = ctx.C;
+        first_block_state[3] = ctx.D;
+    }
+
+    unsigned int target_hash[4];
+    if (ntlm) {
+        unsigned char wide[2 * MAX_NTLM_PASSPHRASE_LENGTH];
+        for (int i = 0; i < length; i++) {
+            wide[2 * i] = target_passphrase[i];
+            wide[2 * i + 1] = 0;
+        }
+        MD4(wide, message_bytes, (unsigned char*)target_hash);   // little-endian words, as above
+    } else {
+        compute_target_hash(target_passphrase, target_hash);
+    }
+
+    char hex_hash[33];
+    hash_to_hex(target_hash, hex_hash);
+
+    printf("\n=== CUDA Passphrase Cracker ===\n");
+    printf("Target passphrase: %s\n", target_passphrase);
+    printf("Passphrase length: %d (%d %s blocks)\n", length, message_blocks, ntlm ? "MD4" : "MD5");
+    printf("Known prefix: %d chars, brute-forced suffix: %d chars\n", prefix_length, suffix_length);
+    printf("Cached first block: %s\n", cache_first_block ? "yes" : "no");
+    printf("Total combinations: %llu\n", total_combinations);
+    printf("Target %s hash: %s\n\n", ntlm ? "NTLM" : "MD5", hex_hash);
+
+    unsigned int* d_message_template;
+    unsigned int* d_first_block_state = NULL;
+    unsigned int* d_target_hash;
+    int* d_found_flag;
+    char* d_result_suffix;
+    unsigned long long* d_found_at_index;
+
+    cudaMalloc(&d_message_template, sizeof(message_template));
+    cudaMalloc(&d_target_hash, 4 * sizeof(unsigned int));
+    cudaMalloc(&d_found_flag, sizeof(int));
+    cudaMalloc(&d_result_suffix, (MAX_PASSWORD_LENGTH + 1) * sizeof(char));
+    cudaMalloc(&d_found_at_index, sizeof(unsigned long long));
+
+    cudaMemcpy(d_message_template, message_template, sizeof(message_template), cudaMemcpyHostToDevice);
+    cudaMemcpy(d_target_hash, target_hash, 4 * sizeof(unsigned int), cudaMemcpyHostToDevice);
+    if (cache_first_block) {
+        cudaMalloc(&d_first_block_state, 4 * sizeof(unsigned int));
+        cudaMemcpy(d_first_block_state, first_block_state, 4 * sizeof(unsigned int), cudaMemcpyHostToDevice);
+    }
+    int zero = 0;
+    cudaMemcpy(d_found_flag, &zero, sizeof(int), cudaMemcpyHostToDevice);
+
+    unsigned long long passwords_per_thread = 100;
+    unsigned long long threads_needed = (total_combinations + passwords_per_thread - 1) / passwords_per_thread;
+    int blocks = (threads_needed + threads_per_block - 1) / threads_per_block;
+
+    cudaEvent_t start, stop;
+    cudaEventCreate(&start);
+    cudaEventCreate(&stop);
+    cudaEventRecord(start);
+
+    crack_passphrase_kernel<<<blocks, threads_per_block>>>(
+        passwords_per_thread,
+        d_message_template,
+        prefix_length,
+        suffix_length,
+        message_blocks,
+        ntlm,
+        d_first_block_state,
+        d_target_hash,
+        d_found_flag,
+        d_result_suffix,
+        d_found_at_index,
+        total_combinations
+    );
+
+    cudaError_t err = cudaGetLastError();
+    if (err != cudaSuccess) {
+        printf("Kernel launch error: %s\n", cudaGetErrorString(err));
+        return 0;
+    }
+
+    cudaDeviceSynchronize();
+    cudaEventRecord(stop);
+    cudaEventSynchronize(stop);
+
+    float milliseconds = 0;
+    cudaEventElapsedTime(&milliseconds, start, stop);
+
+    int found;
+    char result_suffix[MAX_PASSWORD_LENGTH + 1];
+    unsigned long long found_at_index;
+
+    cudaMemcpy(&found, d_found_flag, sizeof(int), cudaMemcpyDeviceToHost);
+    cudaMemcpy(result_suffix, d_result_suffix, (MAX_PASSWORD_LENGTH + 1) * sizeof(char), cudaMemcpyDeviceToHost);
+    cudaMemcpy(&found_at_index, d_found_at_index, sizeof(unsigned long long), cudaMemcpyDeviceToHost);
+
+    if (found) {
+        printf("✓ PASSWORD FOUND! %llu / %llu attempts\n", found_at_index + 1, total_combinations);
+        printf("Passphrase: %.*s%s\n", prefix_length, target_passphrase, result_suffix);
+        printf("Hash: %s\n", hex_hash);
+        printf("Execution time: %.3f seconds\n", milliseconds / 1000.0);
+        printf("Passwords per second: %.0f\n",
+               (total_combinations / (milliseconds / 1000.0)));
+    } else {
+        printf("✗ Password NOT found\n");
+        printf("Execution time: %.3f seconds\n", milliseconds / 1000.0);
+    }
+
+    cudaFree(d_message_template);
+    cudaFree(d_first_block_state);
+    cudaFree(d_target_hash);
+    cudaFree(d_found_flag);
+    cudaFree(d_result_suffix);
+    cudaFree(d_found_at_index);
+    cudaEventDestroy(start);
+    cudaEventDestroy(stop);
+
+    return found;
+}
+
 /*
  * Test function to verify MD5 implementation
  */
@@ -377,6 +652,55 @@ int main(int argc, char* argv[]) {
     printf("Using MD5 Hash Comparison\n");
     printf("========================================\n");
     
+    // Passphrase mode: ./cuda_password_hash -p suffix_length [threads_per_block] [md5|ntlm]
+    if (argc >= 3 && strcmp(argv[1], "-p") == 0) {
+        int suffix_length = atoi(argv[2]);
+        int threads_per_block = argc >= 4 ? atoi(argv[3]) : 256;
+        const char* algorithm = argc >= 5 ? argv[4] : "md5";
+        int ntlm = strcmp(algorithm, "ntlm") == 0;
+        if (!ntlm && strcmp(algorithm, "md5") != 0) {
+            printf("Error: Unknown hash '%s' (use md5 or ntlm)\n", algorithm);
+            return 1;
+        }
+        char passphrase[MAX_PASSPHRASE_LENGTH + 2];
+        
+        printf("Enter passphrase to crack (spaces allowed): ");
+        if (!fgets(passphrase, sizeof(passphrase), stdin)) {
+            printf("Error reading passphrase\n");
+            return 1;
+        }
+        passphrase[strcspn(passphrase, "\r\n")] = '\0';
+        
+        int length = strlen(passphrase);
+        if (length > MAX_PASSPHRASE_LENGTH) {
+            printf("Error: Passphrase too long (max %d characters)\n", MAX_PASSPHRASE_LENGTH);
+            return 1;
+        }
+        if (ntlm && length > MAX_NTLM_PASSPHRASE_LENGTH) {
+            printf("Error: NTLM passphrase too long (max %d characters)\n", MAX_NTLM_PASSPHRASE_LENGTH);
+            return 1;
+        }
+        for (int i = 0; ntlm && i < length; i++) {
+            if ((unsigned char)passphrase[i] > 0x7f) {
+                printf("Error: NTLM passphrases must be ASCII\n");
+                return 1;
+            }
+        }
+        if (suffix_length < 1 || suffix_length > MAX_PASSWORD_LENGTH || suffix_length > length) {
+            printf("Error: Suffix length must be within 1-%d and fit the passphrase\n", MAX_PASSWORD_LENGTH);
+            return 1;
+        }
+        for (int i = length - suffix_length; i < length; i++) {
+            if (passphrase[i] < 'a' || passphrase[i] > 'z') {
+                printf("Error: Suffix must contain only lowercase letters (a-z)\n");
+                return 1;
+            }
+        }
+        
+        crack_passphrase_cuda(passphrase, suffix_length, threads_per_block, ntlm);
+        return 0;
+    }
+    
     char password[MAX_PASSWORD_LENGTH + 1];
     
     printf("Enter password to crack (lowercase letters only): ");
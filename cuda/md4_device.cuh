@@ -0,0 +1,77 @@
+/*
+ * MD4 CUDA Device Implementation (for NTLM)
+ *
+ * Written from the algorithm in RFC 1320. NTLM is MD4 over the UTF-16LE
+ * form of the password, so the message layout (little-endian words, 0x80
+ * padding, bit length in words 14-15) is the same as for MD5 and the same
+ * templates feed either compression function.
+ */
+
+#ifndef MD4_DEVICE_CUH
+#define MD4_DEVICE_CUH
+
+// Basic MD4 functions: selection, majority, parity
+#define MD4_F(x, y, z) (((x) & (y)) | ((~x) & (z)))
+#define MD4_G(x, y, z) (((x) & (y)) | ((x) & (z)) | ((y) & (z)))
+#define MD4_H(x, y, z) ((x) ^ (y) ^ (z))
+
+#define MD4_ROTATE_LEFT(x, n) (((x) << (n)) | ((x) >> (32-(n))))
+
+// Round operations; rounds 2 and 3 add their fixed constants
+#define MD4_FF(a, b, c, d, x, s) \
+  { (a) += MD4_F((b), (c), (d)) + (x); (a) = MD4_ROTATE_LEFT((a), (s)); }
+#define MD4_GG(a, b, c, d, x, s) \
+  { (a) += MD4_G((b), (c), (d)) + (x) + 0x5A827999u; (a) = MD4_ROTATE_LEFT((a), (s)); }
+#define MD4_HH(a, b, c, d, x, s) \
+  { (a) += MD4_H((b), (c), (d)) + (x) + 0x6ED9EBA1u; (a) = MD4_ROTATE_LEFT((a), (s)); }
+
+// MD4 starts from the same state as MD5 (MD5_INIT_A..D)
+
+/**
+ * MD4 Compression Function - Device Code
+ *
+ * Compresses one 64-byte block into a running MD4 state, like
+ * md5_cuda_transform.
+ *
+ * @param in: Input block (16 unsigned ints = 64 bytes)
+ * @param state: Running state (4 unsigned ints), updated in place
+ */
+__device__ void md4_cuda_transform(const unsigned int *in, unsigned int *state) {
+    unsigned int a = state[0];
+    unsigned int b = state[1];
+    unsigned int c = state[2];
+    unsigned int d = state[3];
+
+    /* Round 1: words in order */
+    for (int i = 0; i < 16; i += 4) {
+        MD4_FF(a, b, c, d, in[i + 0],  3);
+        MD4_FF(d, a, b, c, in[i + 1],  7);
+        MD4_FF(c, d, a, b, in[i + 2], 11);
+        MD4_FF(b, c, d, a, in[i + 3], 19);
+    }
+
+    /* Round 2: words by column */
+    for (int i = 0; i < 4; i++) {
+        MD4_GG(a, b, c, d, in[i + 0],  3);
+        MD4_GG(d, a, b, c, in[i + 4],  5);
+        MD4_GG(c, d, a, b, in[i + 8],  9);
+        MD4_GG(b, c, d, a, in[i + 12], 13);
+    }
+
+    /* Round 3: words in bit-reversed order 0, 2, 1, 3 */
+    const int order[4] = { 0, 2, 1, 3 };
+    for (int k = 0; k < 4; k++) {
+        int i = order[k];
+        MD4_HH(a, b, c, d, in[i + 0],  3);
+        MD4_HH(d, a, b, c, in[i + 8],  9);
+        MD4_HH(c, d, a, b, in[i + 4], 11);
+        MD4_HH(b, c, d, a, in[i + 12], 15);
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+}
+
+#endif // MD4_DEVICE_CUH
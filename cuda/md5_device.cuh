@@ -11,6 +11,7 @@
  * - Simplified function signature for password cracking use case
  * - Removed external structure dependencies
  * - Renamed function to md5_cuda for clarity
+ * - Split out md5_cuda_transform for multi-block messages
  * 
  * This file contains ONLY the MD5 hash algorithm.
  * Password generation and parallelization strategy are original work.
@@ -53,27 +54,29 @@
    (a) += (b); \
   }
 
+// MD5 initialization constants
+#define MD5_INIT_A 0x67452301
+#define MD5_INIT_B 0xEFCDAB89
+#define MD5_INIT_C 0x98BADCFE
+#define MD5_INIT_D 0x10325476
+
 /**
- * MD5 Hash Function - Device Code
+ * MD5 Compression Function - Device Code
  * 
- * Computes MD5 hash of input data
+ * Compresses one 64-byte block into a running MD5 state. Messages longer
+ * than one block call this once per block, starting from the init state
+ * or from a state cached after a shared leading block.
  * 
- * @param in: Input buffer (16 unsigned ints = 64 bytes, MD5 block size)
- * @param hash: Output buffer (4 unsigned ints = 16 bytes, MD5 digest size)
+ * @param in: Input block (16 unsigned ints = 64 bytes, MD5 block size)
+ * @param state: Running state (4 unsigned ints), updated in place
  */
-__device__ void md5_cuda(unsigned int *in, unsigned int *hash) {
+__device__ void md5_cuda_transform(const unsigned int *in, unsigned int *state) {
     unsigned int a, b, c, d;
 
-    // MD5 initialization constants
-    const unsigned int a0 = 0x67452301;
-    const unsigned int b0 = 0xEFCDAB89;
-    const unsigned int c0 = 0x98BADCFE;
-    const unsigned int d0 = 0x10325476;
-
-    a = a0;
-    b = b0;
-    c = c0;
-    d = d0;
+    a = state[0];
+    b = state[1];
+    c = state[2];
+    d = state[3];
 
     /* Round 1 */
     #define S11 7
@@ -163,17 +166,28 @@ __device__ void md5_cuda(unsigned int *in, unsigned int *hash) {
     II ( c, d, a, b, in[ 2], S43,  718787259); /* 63 */
     II ( b, c, d, a, in[ 9], S44, 3951481745); /* 64 */
 
-    // Add initial values to final result
-    a += a0;
-    b += b0;
-    c += c0;
-    d += d0;
-
-    // Store hash output (128 bits = 4 x 32-bit integers)
-    hash[0] = a;
-    hash[1] = b;
-    hash[2] = c;
-    hash[3] = d;
+    // Add previous state to the result
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+}
+
+/**
+ * MD5 Hash Function - Device Code
+ * 
+ * Computes MD5 hash of input data
+ * 
+ * @param in: Input buffer (16 unsigned ints = 64 bytes, MD5 block size)
+ * @param hash: Output buffer (4 unsigned ints = 16 bytes, MD5 digest size)
+ */
+__device__ void md5_cuda(unsigned int *in, unsigned int *hash) {
+    hash[0] = MD5_INIT_A;
+    hash[1] = MD5_INIT_B;
+    hash[2] = MD5_INIT_C;
+    hash[3] = MD5_INIT_D;
+
+    md5_cuda_transform(in, hash);
 }
 
 #endif // MD5_DEVICE_CUH
\ No newline at end of file
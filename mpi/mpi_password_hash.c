@@ -1,18 +1,29 @@
 // Compile:
 // mpicc -O3 mpi_password_hash.c -lssl -lcrypto -o mpi_password_hash
+// (add -rdynamic -fno-omit-frame-pointer for function names in --profile output)
 //
 // Run:
 // mpirun -np 8 ./mpi_password_hash
 
+#define _GNU_SOURCE                     // dladdr, SIGEV_THREAD_ID
 #include <mpi.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <sys/syscall.h>
 #include <openssl/md5.h>
 
 #define CHARSET "abcdefghijklmnopqrstuvwxyz"
 #define CHARSET_SIZE 26
 #define MAX_PASSWORD_LENGTH 10
+#define MAX_WORD_LENGTH 55              // Longest candidate in one MD5 block
 #define TERMINATE_TAG 999
 #define PROGRESS_TAG 998
 
@@ -44,86 +55,2099 @@ void generate_hash(const char *password, unsigned char *hash) {
     MD5((unsigned char*)password, strlen(password), hash);
 }
 
+// ---------------------------------------------
+// Hex digest helpers
+// ---------------------------------------------
+int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+int parse_hex_digest(const char *hex, unsigned char *digest) {
+    for (int i = 0; i < MD5_DIGEST_LENGTH; i++) {
+        int high = hex_value(hex[i * 2]);
+        int low = hex_value(hex[i * 2 + 1]);
+        if (high < 0 || low < 0)
+            return 0;
+        digest[i] = (high << 4) | low;
+    }
+    return 1;
+}
+
+void hash_to_hex(const unsigned char *hash, char *output) {
+    for (int i = 0; i < MD5_DIGEST_LENGTH; i++)
+        sprintf(output + (i * 2), "%02x", hash[i]);
+    output[MD5_DIGEST_LENGTH * 2] = '\0';
+}
+
+// ---------------------------------------------
+// SAMPLING PROFILER
+// ---------------------------------------------
+// --profile FILE samples each rank's main thread with a wall-clock timer
+// (timer_create, SIGPROF), so time blocked in MPI shows up too. The handler
+// only copies return addresses into a preallocated buffer. Each rank writes
+// folded stacks ("rank N;main;...;leaf count") to FILE.<rank> at the end.
+
+#define PROFILE_DEFAULT_HZ 99
+#define PROFILE_MAX_SAMPLES 16384       // Later samples are counted as dropped
+#define PROFILE_MAX_DEPTH 32
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+const char *profile_path = NULL;
+int profile_hz = PROFILE_DEFAULT_HZ;
+void *(*profile_frames)[PROFILE_MAX_DEPTH];
+unsigned char *profile_depth;
+volatile int profile_count, profile_dropped;
+int profile_armed;
+timer_t profile_timer;
+
+void profile_signal(int signal, siginfo_t *info, void *context) {
+    (void)signal; (void)info; (void)context;
+    int n = profile_count;
+    if (n == PROFILE_MAX_SAMPLES) {
+        profile_dropped++;
+        return;
+    }
+    profile_depth[n] = backtrace(profile_frames[n], PROFILE_MAX_DEPTH);
+    profile_count = n + 1;
+}
+
+void start_profiler(void) {
+    profile_frames = malloc(PROFILE_MAX_SAMPLES * sizeof(*profile_frames));
+    profile_depth = malloc(PROFILE_MAX_SAMPLES);
+
+    // backtrace() loads the unwinder on first use; do that outside the handler
+    void *warm[1];
+    backtrace(warm, 1);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = profile_signal;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGPROF, &action, NULL);
+
+    // Thread-directed: MPI progress threads must not take the samples
+    struct sigevent event;
+    memset(&event, 0, sizeof(event));
+    event.sigev_notify = SIGEV_THREAD_ID;
+    event.sigev_signo = SIGPROF;
+    event.sigev_notify_thread_id = syscall(SYS_gettid);
+    if (timer_create(CLOCK_MONOTONIC, &event, &profile_timer) != 0)
+        return;
+
+    long interval = 1000000000L / profile_hz;
+    struct itimerspec spec = { { interval / 1000000000L, interval % 1000000000L },
+                               { interval / 1000000000L, interval % 1000000000L } };
+    timer_settime(profile_timer, 0, &spec, NULL);
+    profile_armed = 1;
+}
+
+void frame_name(void *address, char *name, size_t size) {
+    Dl_info info;
+    if (!dladdr(address, &info)) {
+        snprintf(name, size, "[unknown]");
+    } else if (info.dli_sname) {
+        snprintf(name, size, "%s", info.dli_sname);
+    } else if (info.dli_fname) {
+        // Static functions only resolve to their module
+        const char *base = strrchr(info.dli_fname, '/');
+        snprintf(name, size, "[%s]", base ? base + 1 : info.dli_fname);
+    } else {
+        snprintf(name, size, "[unknown]");
+    }
+}
+
+int compare_strings(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// Stop the timer and fold identical stacks into FILE.<rank>
+void write_profile(int rank) {
+    if (!profile_armed)
+        return;
+    timer_delete(profile_timer);
+    signal(SIGPROF, SIG_IGN);
+    profile_armed = 0;
+
+    size_t stack_size = PROFILE_MAX_DEPTH * 128 + 32;
+    char **stacks = malloc((profile_count + 1) * sizeof(char *));
+    for (int k = 0; k < profile_count; k++) {
+        stacks[k] = malloc(stack_size);
+        int length = snprintf(stacks[k], stack_size, "rank %d", rank);
+        // Outermost frame first; the two innermost are the handler and the signal trampoline
+        for (int f = profile_depth[k] - 1; f >= 2; f--) {
+            char name[128];
+            frame_name(profile_frames[k][f], name, sizeof(name));
+            length += snprintf(stacks[k] + length, stack_size - length, ";%s", name);
+        }
+    }
+    qsort(stacks, profile_count, sizeof(char *), compare_strings);
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s.%d", profile_path, rank);
+    FILE *out = fopen(path, "w");
+    if (!out)
+        printf("Warning: cannot write %s\n", path);
+    for (int k = 0; k < profile_count; ) {
+        int same = 1;
+        while (k + same < profile_count && strcmp(stacks[k], stacks[k + same]) == 0)
+            same++;
+        if (out)
+            fprintf(out, "%s %d\n", stacks[k], same);
+        for (int j = 0; j < same; j++)
+            free(stacks[k + j]);
+        k += same;
+    }
+    if (out) {
+        fclose(out);
+        if (rank == 0)
+            printf("Profile: %d samples at %d Hz (%d dropped) on rank 0, written to %s.<rank>\n",
+                   profile_count, profile_hz, profile_dropped, profile_path);
+    }
+    free(stacks);
+    free(profile_frames);
+    free(profile_depth);
+}
+
+// ---------------------------------------------
+// MEMORY ACCOUNTING
+// ---------------------------------------------
+// Each rank tags its large buffers by subsystem and keeps live and peak
+// byte counts, and samples its RSS from /proc at the periodic checks. When
+// a mode ends, the peaks and every rank's VmHWM are reduced to rank 0 for
+// the summary and the optional --report (JSON) / --metrics (Prometheus) files.
+
+typedef enum {
+    MEM_HIT_BATCHES,
+    MEM_TARGET_SHARD,
+    MEM_EXCHANGE,
+    MEM_DICTIONARY,
+    MEM_SUBSYSTEMS
+} memory_subsystem;
+
+static const char *MEMORY_NAMES[] = {
+    "hit batches", "target shard", "exchange buffers", "dictionary buffers"
+};
+
+#define MAX_RSS_SAMPLES 512
+#define RSS_INTERVAL 0.05           // Seconds between samples, doubled when full
+
+long long memory_live[MEM_SUBSYSTEMS];
+long long memory_peak[MEM_SUBSYSTEMS];
+double rss_seconds[MAX_RSS_SAMPLES];
+unsigned long long rss_bytes[MAX_RSS_SAMPLES];
+int rss_count;
+double rss_interval = RSS_INTERVAL;
+double rss_start, rss_last = -1;
+const char *report_path = NULL;
+const char *metrics_path = NULL;
+
+// Positive when allocating, negative when freeing
+void track_memory(memory_subsystem subsystem, long long bytes) {
+    memory_live[subsystem] += bytes;
+    if (memory_live[subsystem] > memory_peak[subsystem])
+        memory_peak[subsystem] = memory_live[subsystem];
+}
+
+// Current and high-water RSS in bytes; returns 0 without /proc
+int read_rss(unsigned long long *current, unsigned long long *high_water) {
+    FILE *fp = fopen("/proc/self/status", "r");
+    if (!fp)
+        return 0;
+
+    char line[128];
+    unsigned long long kb;
+    *current = *high_water = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        if (sscanf(line, "VmRSS: %llu kB", &kb) == 1)
+            *current = kb << 10;
+        else if (sscanf(line, "VmHWM: %llu kB", &kb) == 1)
+            *high_water = kb << 10;
+    }
+    fclose(fp);
+    return 1;
+}
+
+// Rate-limited; a full buffer keeps every other sample and halves the rate
+void sample_rss(void) {
+    double now = MPI_Wtime() - rss_start;
+    unsigned long long current, high_water;
+    if (now - rss_last < rss_interval || !read_rss(&current, &high_water))
+        return;
+
+    if (rss_count == MAX_RSS_SAMPLES) {
+        for (int i = 0; i < MAX_RSS_SAMPLES / 2; i++) {
+            rss_seconds[i] = rss_seconds[2 * i];
+            rss_bytes[i] = rss_bytes[2 * i];
+        }
+        rss_count = MAX_RSS_SAMPLES / 2;
+        rss_interval *= 2;
+    }
+    rss_seconds[rss_count] = now;
+    rss_bytes[rss_count++] = current;
+    rss_last = now;
+}
+
+void write_json_report(FILE *out, const char *mode, int world_size, double elapsed,
+                       const long long *peak_max, const long long *peak_sum,
+                       const unsigned long long *rank_hwm) {
+    fprintf(out, "{\n");
+    fprintf(out, "  \"program\": \"mpi_password_hash\",\n");
+    fprintf(out, "  \"mode\": \"%s\",\n", mode);
+    fprintf(out, "  \"ranks\": %d,\n", world_size);
+    fprintf(out, "  \"elapsed_seconds\": %.3f,\n", elapsed);
+    fprintf(out, "  \"memory\": {\n");
+    for (int s = 0; s < MEM_SUBSYSTEMS; s++)
+        fprintf(out, "    \"%s\": { \"peak_bytes_max_rank\": %lld, \"peak_bytes_sum\": %lld }%s\n",
+                MEMORY_NAMES[s], peak_max[s], peak_sum[s], s + 1 < MEM_SUBSYSTEMS ? "," : "");
+    fprintf(out, "  },\n");
+    fprintf(out, "  \"rss\": {\n");
+    fprintf(out, "    \"peak_bytes_per_rank\": [");
+    for (int r = 0; r < world_size; r++)
+        fprintf(out, "%s%llu", r ? ", " : "", rank_hwm[r]);
+    fprintf(out, "],\n");
+    fprintf(out, "    \"rank0_interval_seconds\": %.3f,\n", rss_interval);
+    fprintf(out, "    \"rank0_samples\": [");
+    for (int i = 0; i < rss_count; i++)
+        fprintf(out, "%s[%.3f, %llu]", i ? ", " : "", rss_seconds[i], rss_bytes[i]);
+    fprintf(out, "]\n");
+    fprintf(out, "  }\n");
+    fprintf(out, "}\n");
+}
+
+void write_metrics(FILE *out, const char *mode, int world_size, double elapsed,
+                   const long long *peak_max, const unsigned long long *rank_hwm) {
+    fprintf(out, "# HELP password_hash_elapsed_seconds Wall time of the run\n");
+    fprintf(out, "# TYPE password_hash_elapsed_seconds gauge\n");
+    fprintf(out, "password_hash_elapsed_seconds{mode=\"%s\"} %.3f\n", mode, elapsed);
+    fprintf(out, "# HELP password_hash_memory_peak_bytes Peak bytes per subsystem on the largest rank\n");
+    fprintf(out, "# TYPE password_hash_memory_peak_bytes gauge\n");
+    for (int s = 0; s < MEM_SUBSYSTEMS; s++)
+        fprintf(out, "password_hash_memory_peak_bytes{subsystem=\"%s\"} %lld\n",
+                MEMORY_NAMES[s], peak_max[s]);
+    fprintf(out, "# HELP password_hash_rss_peak_bytes Peak resident set size (VmHWM) per rank\n");
+    fprintf(out, "# TYPE password_hash_rss_peak_bytes gauge\n");
+    for (int r = 0; r < world_size; r++)
+        fprintf(out, "password_hash_rss_peak_bytes{rank=\"%d\"} %llu\n", r, rank_hwm[r]);
+}
+
+// Collective: reduce the accounting to rank 0, print it and write the reports
+void report_memory(const char *mode, int rank, int world_size) {
+    double elapsed = MPI_Wtime() - rss_start;
+    unsigned long long current = 0, high_water = 0;
+    read_rss(&current, &high_water);
+
+    long long peak_max[MEM_SUBSYSTEMS], peak_sum[MEM_SUBSYSTEMS];
+    unsigned long long *rank_hwm = rank == 0 ? malloc(world_size * sizeof(unsigned long long)) : NULL;
+    MPI_Reduce(memory_peak, peak_max, MEM_SUBSYSTEMS, MPI_LONG_LONG, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(memory_peak, peak_sum, MEM_SUBSYSTEMS, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Gather(&high_water, 1, MPI_UNSIGNED_LONG_LONG, rank_hwm, 1, MPI_UNSIGNED_LONG_LONG,
+               0, MPI_COMM_WORLD);
+    if (rank != 0)
+        return;
+
+    int largest = 0;
+    unsigned long long total = 0;
+    for (int r = 0; r < world_size; r++) {
+        total += rank_hwm[r];
+        if (rank_hwm[r] > rank_hwm[largest])
+            largest = r;
+    }
+    printf("Peak RSS: %.1f MB on rank %d, %.1f MB over all ranks\n",
+           rank_hwm[largest] / 1048576.0, largest, total / 1048576.0);
+    for (int s = 0; s < MEM_SUBSYSTEMS; s++) {
+        if (peak_sum[s] > 0)
+            printf("  %-18s peak %8.2f MB per rank (max), %8.2f MB total\n",
+                   MEMORY_NAMES[s], peak_max[s] / 1048576.0, peak_sum[s] / 1048576.0);
+    }
+
+    const char *paths[2] = { report_path, metrics_path };
+    for (int k = 0; k < 2; k++) {
+        if (!paths[k])
+            continue;
+        FILE *out = fopen(paths[k], "w");
+        if (!out) {
+            printf("Warning: cannot write %s\n", paths[k]);
+            continue;
+        }
+        if (k == 0)
+            write_json_report(out, mode, world_size, elapsed, peak_max, peak_sum, rank_hwm);
+        else
+            write_metrics(out, mode, world_size, elapsed, peak_max, rank_hwm);
+        fclose(out);
+        printf("%s written to %s\n", k == 0 ? "Run report" : "Metrics", paths[k]);
+    }
+    free(rank_hwm);
+}
+
+// ---------------------------------------------
+// RESULT COLLECTION (POTFILE WRITER)
+// ---------------------------------------------
+// Ranks never print cracked passwords themselves. A hit is a compact
+// (target id, candidate index) record; records are batched and sent with
+// MPI_Isend to the writer rank, which turns them back into passwords and
+// appends "hash:password" lines to the potfile. Sending never blocks: if
+// the writer falls behind, more batches are simply kept in flight.
+
+#define WRITER_RANK 0
+#define HIT_TAG 1
+#define HIT_DONE_TAG 2
+#define HIT_BATCH 64            // Records per message
+#define POTFILE_PATH "mpi_password_hash.pot"
+
+int use_potfile = 1;            // Cleared in benchmark mode
+
+typedef struct {
+    long long target;           // Target id (line number in multi-target modes)
+    unsigned long long index;   // Mode-specific candidate index
+} hit_record;
+
+typedef struct {
+    hit_record records[HIT_BATCH];
+    MPI_Request request;
+} hit_batch;
+
+typedef struct result_channel result_channel;
+
+// Turn a record back into "hash" and "password"; returns 0 to drop it
+typedef int (*hit_resolver)(result_channel *results, const hit_record *hit,
+                            char *hex, char *password);
+
+struct result_channel {
+    MPI_Comm comm;              // Private communicator: hit tags never clash
+    int world_size;
+
+    // Sender side (every rank)
+    hit_batch *current;         // Batch being filled
+    int count;
+    hit_batch **in_flight;      // Posted, not yet completed
+    int in_flight_count, in_flight_capacity;
+    hit_batch **spare;          // Completed, ready for reuse
+    int spare_count;
+    MPI_Request done_request;
+
+    // Writer side (WRITER_RANK only)
+    int is_writer;
+    FILE *potfile;
+    int done_ranks;
+    int written;
+    hit_resolver resolve;       // NULL: keep records in `deferred` for the mode
+    void *context;
+    hit_record *deferred;
+    int deferred_count, deferred_capacity;
+};
+
+void result_channel_open(result_channel *results, int rank, int world_size) {
+    memset(results, 0, sizeof(*results));
+    MPI_Comm_dup(MPI_COMM_WORLD, &results->comm);
+    results->world_size = world_size;
+    results->done_request = MPI_REQUEST_NULL;
+    results->current = malloc(sizeof(hit_batch));
+    track_memory(MEM_HIT_BATCHES, sizeof(hit_batch));
+
+    if (rank == WRITER_RANK) {
+        results->is_writer = 1;
+        results->potfile = use_potfile ? fopen(POTFILE_PATH, "a") : NULL;
+        if (use_potfile && !results->potfile)
+            printf("Warning: cannot open %s, results go to stdout only\n", POTFILE_PATH);
+    }
+}
+
+void write_hit(result_channel *results, const char *hex, const char *password) {
+    if (results->potfile)
+        fprintf(results->potfile, "%s:%s\n", hex, password);
+    printf("%s:%s\n", hex, password);
+    results->written++;
+}
+
+void store_hit(result_channel *results, const hit_record *hit) {
+    char hex[MD5_DIGEST_LENGTH * 2 + 1];
+    char password[MAX_WORD_LENGTH + 1];
+
+    if (results->resolve) {
+        if (results->resolve(results, hit, hex, password))
+            write_hit(results, hex, password);
+        return;
+    }
+
+    if (results->deferred_count == results->deferred_capacity) {
+        track_memory(MEM_HIT_BATCHES, -(long long)results->deferred_capacity * sizeof(hit_record));
+        results->deferred_capacity = results->deferred_capacity ? 2 * results->deferred_capacity : 256;
+        track_memory(MEM_HIT_BATCHES, results->deferred_capacity * sizeof(hit_record));
+        results->deferred = realloc(results->deferred,
+                                    results->deferred_capacity * sizeof(hit_record));
+    }
+    results->deferred[results->deferred_count++] = *hit;
+}
+
+void receive_hits(result_channel *results, MPI_Status *status) {
+    hit_record records[HIT_BATCH];
+    int bytes;
+
+    MPI_Get_count(status, MPI_BYTE, &bytes);
+    MPI_Recv(records, bytes, MPI_BYTE, status->MPI_SOURCE, status->MPI_TAG,
+             results->comm, MPI_STATUS_IGNORE);
+
+    if (status->MPI_TAG == HIT_DONE_TAG) {
+        results->done_ranks++;
+        return;
+    }
+    for (int k = 0; k < bytes / (int)sizeof(hit_record); k++)
+        store_hit(results, &records[k]);
+}
+
+// Writer: drain whatever has arrived, without blocking
+void poll_hits(result_channel *results) {
+    int flag = 1;
+    MPI_Status status;
+
+    while (flag) {
+        MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, results->comm, &flag, &status);
+        if (flag)
+            receive_hits(results, &status);
+    }
+}
+
+// Move completed sends to the spare list
+void reap_hit_batches(result_channel *results) {
+    int k = 0;
+    while (k < results->in_flight_count) {
+        int done = 0;
+        MPI_Test(&results->in_flight[k]->request, &done, MPI_STATUS_IGNORE);
+        if (done) {
+            results->spare[results->spare_count++] = results->in_flight[k];
+            results->in_flight[k] = results->in_flight[--results->in_flight_count];
+        } else {
+            k++;
+        }
+    }
+}
+
+// Post the current batch and start filling a fresh one
+void flush_hits(result_channel *results) {
+    if (results->count == 0)
+        return;
+
+    if (results->in_flight_count == results->in_flight_capacity) {
+        results->in_flight_capacity = results->in_flight_capacity ? 2 * results->in_flight_capacity : 8;
+        results->in_flight = realloc(results->in_flight,
+                                     results->in_flight_capacity * sizeof(hit_batch *));
+        results->spare = realloc(results->spare,
+                                 results->in_flight_capacity * sizeof(hit_batch *));
+    }
+
+    MPI_Isend(results->current->records, results->count * sizeof(hit_record), MPI_BYTE,
+              WRITER_RANK, HIT_TAG, results->comm, &results->current->request);
+    results->in_flight[results->in_flight_count++] = results->current;
+    results->count = 0;
+
+    reap_hit_batches(results);
+    if (results->spare_count > 0) {
+        results->current = results->spare[--results->spare_count];
+    } else {
+        results->current = malloc(sizeof(hit_batch));
+        track_memory(MEM_HIT_BATCHES, sizeof(hit_batch));
+    }
+}
+
+void report_hit(result_channel *results, long long target, unsigned long long index) {
+    results->current->records[results->count].target = target;
+    results->current->records[results->count].index = index;
+    if (++results->count == HIT_BATCH)
+        flush_hits(results);
+}
+
+// Called at each rank's periodic check: ship partial batches, and on the
+// writer, collect what others have sent
+void service_hits(result_channel *results) {
+    sample_rss();
+    flush_hits(results);
+    if (results->is_writer)
+        poll_hits(results);
+}
+
+// Flush, tell the writer this rank is done, and (on the writer) wait for
+// every rank's final records. Returns the number of lines written.
+int result_channel_close(result_channel *results) {
+    flush_hits(results);
+    MPI_Isend(NULL, 0, MPI_BYTE, WRITER_RANK, HIT_DONE_TAG, results->comm,
+              &results->done_request);
+
+    if (results->is_writer) {
+        MPI_Status status;
+        while (results->done_ranks < results->world_size) {
+            MPI_Probe(MPI_ANY_SOURCE, MPI_ANY_TAG, results->comm, &status);
+            receive_hits(results, &status);
+        }
+    }
+
+    for (int k = 0; k < results->in_flight_count; k++)
+        MPI_Wait(&results->in_flight[k]->request, MPI_STATUS_IGNORE);
+    reap_hit_batches(results);
+    MPI_Wait(&results->done_request, MPI_STATUS_IGNORE);
+    return results->written;
+}
+
+void result_channel_free(result_channel *results) {
+    if (results->potfile) {
+        fclose(results->potfile);
+        if (results->written > 0)
+            printf("Results appended to %s\n", POTFILE_PATH);
+    }
+    for (int k = 0; k < results->spare_count; k++)
+        free(results->spare[k]);
+    track_memory(MEM_HIT_BATCHES, -(long long)(results->spare_count + 1) * sizeof(hit_batch));
+    track_memory(MEM_HIT_BATCHES, -(long long)results->deferred_capacity * sizeof(hit_record));
+    free(results->spare);
+    free(results->in_flight);
+    free(results->current);
+    free(results->deferred);
+    MPI_Comm_free(&results->comm);
+}
+
 // ---------------------------------------------
 // Brute-force search with clean termination
 // ---------------------------------------------
+// Rank r takes blocks r, r + world_size, ... of `chunk_size` candidates
+// (1 is the plain stride). Every `check_interval` candidates it services
+// hits, polls for termination and sends its progress; --no-comm skips all
+// of that to give the communication-free baseline for benchmarks. Without
+// polling nobody would read a termination message, so none is sent and
+// every rank finishes its share.
+
+#define CHECK_INTERVAL 50000
+
+unsigned long long check_interval = CHECK_INTERVAL;
+unsigned long long chunk_size = 1;
+int communicate = 1;
+int show_progress = 1;
+int speculative_tail = 1;       // Cleared by --no-speculation
+int straggler_slowdown = 1;     // Set by -T: the last rank hashes each candidate this often
+
+// Tail splitting. A rank's work is a span of blocks base + k * world_size,
+// k in [next, end); every rank starts with its own stride. The spans live
+// in a window on rank 0 and are only read or changed under an exclusive
+// lock. Ranks claim about one check interval of blocks at a time. A rank
+// whose span is used up takes the upper half of the largest remaining span
+// and makes it its own, so it can be split again. Nothing runs twice, so
+// there is nothing to cancel. Off with --no-speculation or --no-comm.
+
+#define SPAN_SLOTS 3            // base, next, end
+
+typedef struct {
+    MPI_Win win;
+    long long *shared;          // Rank 0: every rank's span
+    long long *view;            // A copy of all spans, read under the lock
+    int rank, world_size;
+    int split;
+    long long step;             // Blocks claimed at a time
+    long long own[SPAN_SLOTS];  // Without splitting: this rank's stride
+    double tail_start;          // When this rank first found its span used up
+    unsigned long long splits;
+} block_spans;
+
+// Collective
+void block_spans_open(block_spans *spans, unsigned long long blocks, int rank, int world_size) {
+    memset(spans, 0, sizeof(*spans));
+    spans->rank = rank;
+    spans->world_size = world_size;
+    spans->split = speculative_tail && communicate;
+    spans->step = chunk_size < check_interval ? check_interval / chunk_size : 1;
+    spans->own[0] = rank;
+    spans->own[2] = (unsigned long long)rank < blocks ?
+                    (blocks - rank + world_size - 1) / world_size : 0;
+    if (!spans->split)
+        return;
+
+    spans->view = malloc(world_size * SPAN_SLOTS * sizeof(long long));
+    MPI_Win_allocate(rank == 0 ? world_size * SPAN_SLOTS * sizeof(long long) : 0,
+                     sizeof(long long), MPI_INFO_NULL, MPI_COMM_WORLD, &spans->shared, &spans->win);
+    if (rank == 0) {
+        MPI_Win_lock(MPI_LOCK_EXCLUSIVE, 0, 0, spans->win);
+        for (int p = 0; p < world_size; p++) {
+            spans->shared[p * SPAN_SLOTS + 0] = p;
+            spans->shared[p * SPAN_SLOTS + 1] = 0;
+            spans->shared[p * SPAN_SLOTS + 2] = (unsigned long long)p < blocks ?
+                                                (blocks - p + world_size - 1) / world_size : 0;
+        }
+        MPI_Win_unlock(0, spans->win);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+}
+
+// Claim the next blocks base + k * world_size, k in [from, to); returns 0
+// when there is no work left anywhere worth splitting
+int claim_blocks(block_spans *spans, long long *base, long long *from, long long *to) {
+    if (!spans->split) {
+        *base = spans->own[0];
+        *from = spans->own[1];
+        *to = spans->own[2];
+        spans->own[1] = spans->own[2];
+        if (*from >= *to && spans->tail_start == 0)
+            spans->tail_start = MPI_Wtime();
+        return *from < *to;
+    }
+
+    int n = spans->world_size;
+    long long *all = spans->view;
+    long long *mine = all + spans->rank * SPAN_SLOTS;
+
+    MPI_Win_lock(MPI_LOCK_EXCLUSIVE, 0, 0, spans->win);
+    MPI_Get(all, n * SPAN_SLOTS, MPI_LONG_LONG, 0, 0, n * SPAN_SLOTS, MPI_LONG_LONG, spans->win);
+    MPI_Win_flush(0, spans->win);
+
+    if (mine[1] >= mine[2]) {
+        if (spans->tail_start == 0)
+            spans->tail_start = MPI_Wtime();
+
+        // Splitting a span shorter than two steps would not save anything
+        int victim = -1;
+        long long most = 2 * spans->step - 1;
+        for (int p = 0; p < n; p++) {
+            long long remaining = all[p * SPAN_SLOTS + 2] - all[p * SPAN_SLOTS + 1];
+            if (remaining > most) {
+                victim = p;
+                most = remaining;
+            }
+        }
+        if (victim >= 0) {
+            long long *v = all + victim * SPAN_SLOTS;
+            mine[0] = v[0];
+            mine[1] = v[1] + most / 2;
+            mine[2] = v[2];
+            v[2] = mine[1];
+            MPI_Put(&v[2], 1, MPI_LONG_LONG, 0, victim * SPAN_SLOTS + 2, 1, MPI_LONG_LONG,
+                    spans->win);
+            spans->splits++;
+        }
+    }
+
+    *base = mine[0];
+    *from = mine[1];
+    *to = mine[1] + spans->step < mine[2] ? mine[1] + spans->step : mine[2];
+    mine[1] = *to;
+    MPI_Put(mine, SPAN_SLOTS, MPI_LONG_LONG, 0, spans->rank * SPAN_SLOTS, SPAN_SLOTS,
+            MPI_LONG_LONG, spans->win);
+    MPI_Win_unlock(0, spans->win);
+    return *from < *to;
+}
+
+// Collective
+void block_spans_close(block_spans *spans) {
+    if (!spans->split)
+        return;
+    MPI_Win_free(&spans->win);
+    free(spans->view);
+}
+
+// Filled in by mpi_crack for the benchmark mode
+typedef struct {
+    unsigned long long tried;
+    double loop_time;           // From the first candidate to leaving the loop
+    double comm_time;           // Inside the periodic checks
+    double hit_time;            // MPI_Wtime of the hit on the finding rank, else 0
+    double exit_time;           // MPI_Wtime on leaving the loop
+    double tail_start;          // MPI_Wtime when this rank ran out of its own work, else 0
+    unsigned long long splits;  // Spans this rank took from others
+} crack_stats;
+
+typedef struct {
+    const unsigned char *target_hash;
+    int length;
+} brute_force_context;
+
+int resolve_brute_force(result_channel *results, const hit_record *hit,
+                        char *hex, char *password) {
+    brute_force_context *ctx = results->context;
+    hash_to_hex(ctx->target_hash, hex);
+    number_to_password(hit->index, password, ctx->length);
+    return 1;
+}
+
 int mpi_crack(const unsigned char *target_hash, int length,
-              int rank, int world_size) {
+              int rank, int world_size, result_channel *results, crack_stats *stats) {
 
     unsigned long long total = calculate_combinations(length);
 
     char guess[MAX_PASSWORD_LENGTH + 1];
     unsigned char guess_hash[MD5_DIGEST_LENGTH];
 
-    int terminate_flag;
+    int terminate_flag, terminated = 0, terminate_signal = 1;
     MPI_Status status;
-    MPI_Request progress_req;
+    MPI_Request progress_req = MPI_REQUEST_NULL;
+    MPI_Request *terminate_reqs = malloc(world_size * sizeof(MPI_Request));
+    for (int p = 0; p < world_size; p++)
+        terminate_reqs[p] = MPI_REQUEST_NULL;
 
-    unsigned long long check_interval = 50000;
     unsigned long long counter = 0;
     unsigned long long local_count = 0;
+    unsigned long long progress_sent = 0, progress_received = 0;
+    int found = 0, stop = 0;
+    double comm_time = 0, hit_time = 0;
 
-    for (unsigned long long i = rank; i < total; i += world_size) {
+    brute_force_context context = { target_hash, length };
+    results->resolve = resolve_brute_force;
+    results->context = &context;
 
-        // ----------- CHECK FOR TERMINATION & SEND PROGRESS ----------
-        if (++counter % check_interval == 0) {
-            int flag = 0;
-            MPI_Iprobe(MPI_ANY_SOURCE, TERMINATE_TAG, MPI_COMM_WORLD, &flag, &status);
-            if (flag) {
-                MPI_Recv(&terminate_flag, 1, MPI_INT, status.MPI_SOURCE,
-                         TERMINATE_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                return 0;
-            }
+    block_spans spans;
+    block_spans_open(&spans, (total + chunk_size - 1) / chunk_size, rank, world_size);
+    int repeats = rank == world_size - 1 ? straggler_slowdown : 1;
+    long long base, from, to;
+
+    double loop_start = MPI_Wtime();
+    while (!stop && claim_blocks(&spans, &base, &from, &to)) {
+        for (long long k = from; !stop && k < to; k++) {
+            unsigned long long block = base + k * world_size;
+            unsigned long long first = block * chunk_size;
+            unsigned long long last = first + chunk_size < total ? first + chunk_size : total;
+            for (unsigned long long i = first; i < last; i++) {
+                double check_start = 0;
+
+                // ----------- CHECK FOR TERMINATION & SEND PROGRESS ----------
+                if (++counter % check_interval == 0 && communicate) {
+                    check_start = MPI_Wtime();
+                    service_hits(results);
+
+                    int flag = 0;
+                    MPI_Iprobe(MPI_ANY_SOURCE, TERMINATE_TAG, MPI_COMM_WORLD, &flag, &status);
+                    if (flag) {
+                        MPI_Recv(&terminate_flag, 1, MPI_INT, status.MPI_SOURCE,
+                                 TERMINATE_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                        comm_time += MPI_Wtime() - check_start;
+                        terminated = 1;
+                        stop = 1;
+                        break;
+                    }
             
-            if (rank != 0) {
-                local_count = counter;
-                MPI_Isend(&local_count, 1, MPI_UNSIGNED_LONG_LONG, 0, PROGRESS_TAG, MPI_COMM_WORLD, &progress_req);
-            }
-        }
+                    // local_count is the send buffer: skip a report while the last is in flight
+                    int sent = 1;
+                    if (rank != 0)
+                        MPI_Test(&progress_req, &sent, MPI_STATUS_IGNORE);
+                    if (rank != 0 && sent) {
+                        local_count = counter;
+                        MPI_Isend(&local_count, 1, MPI_UNSIGNED_LONG_LONG, 0, PROGRESS_TAG, MPI_COMM_WORLD, &progress_req);
+                        progress_sent++;
+                    }
+                }
         
-        // ----------- RANK 0: COLLECT PROGRESS ----------
-        if (rank == 0 && counter % check_interval == 0) {
-            unsigned long long total_progress = counter;
-            int flag;
-            unsigned long long worker_count;
+                // ----------- RANK 0: COLLECT PROGRESS ----------
+                if (rank == 0 && counter % check_interval == 0 && communicate) {
+                    unsigned long long total_progress = counter;
+                    int flag;
+                    unsigned long long worker_count;
             
-            for (int p = 1; p < world_size; p++) {
-                MPI_Iprobe(p, PROGRESS_TAG, MPI_COMM_WORLD, &flag, &status);
-                if (flag) {
-                    MPI_Recv(&worker_count, 1, MPI_UNSIGNED_LONG_LONG, p, PROGRESS_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                    total_progress += worker_count;
+                    for (int p = 1; p < world_size; p++) {
+                        MPI_Iprobe(p, PROGRESS_TAG, MPI_COMM_WORLD, &flag, &status);
+                        if (flag) {
+                            MPI_Recv(&worker_count, 1, MPI_UNSIGNED_LONG_LONG, p, PROGRESS_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                            total_progress += worker_count;
+                            progress_received++;
+                        }
+                    }
+            
+                    if (show_progress) {
+                        printf("Progress: %llu / %llu (%.2f%%)\r", total_progress, total, (total_progress * 100.0) / total);
+                        fflush(stdout);
+                    }
+                }
+                if (check_start > 0)
+                    comm_time += MPI_Wtime() - check_start;
+
+                // ----------- GENERATE GUESS ----------
+                number_to_password(i, guess, length);
+                for (int r = 0; r < repeats; r++)
+                    generate_hash(guess, guess_hash);
+
+                // ----------- CHECK MATCH ----------
+                if (memcmp(guess_hash, target_hash, MD5_DIGEST_LENGTH) == 0) {
+                    hit_time = MPI_Wtime();
+
+                    // The writer rank reports it; ship the record right away
+                    report_hit(results, 0, i);
+                    flush_hits(results);
+                    found = 1;
+
+                    // Send termination message to all other ranks
+                    for (int p = 0; p < world_size && communicate; p++) {
+                        if (p != rank) {
+                            MPI_Isend(&terminate_signal, 1, MPI_INT, p, TERMINATE_TAG, MPI_COMM_WORLD,
+                                      &terminate_reqs[p]);
+                        }
+                    }
+
+                    stop = 1;
+                    break;
                 }
             }
-            
-            printf("Progress: %llu / %llu (%.2f%%)\r", total_progress, total, (total_progress * 100.0) / total);
-            fflush(stdout);
         }
+    }
+
+    if (stats) {
+        stats->exit_time = MPI_Wtime();
+        stats->loop_time = stats->exit_time - loop_start;
+        stats->tried = counter;
+        stats->comm_time = comm_time;
+        stats->hit_time = hit_time;
+        stats->tail_start = spans.tail_start;
+        stats->splits = spans.splits;
+    }
+
+    // Settle every message the loop left in flight before returning: progress
+    // reports rank 0 has not read yet, and termination messages to ranks that
+    // ran out of work before they polled for one
+    unsigned long long sent_total = 0, late_count;
+    MPI_Reduce(&progress_sent, &sent_total, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    for (; rank == 0 && progress_received < sent_total; progress_received++)
+        MPI_Recv(&late_count, 1, MPI_UNSIGNED_LONG_LONG, MPI_ANY_SOURCE, PROGRESS_TAG,
+                 MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    MPI_Wait(&progress_req, MPI_STATUS_IGNORE);
+
+    int any_found;
+    MPI_Allreduce(&found, &any_found, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    if (any_found && !found && !terminated && communicate)
+        MPI_Recv(&terminate_flag, 1, MPI_INT, MPI_ANY_SOURCE, TERMINATE_TAG, MPI_COMM_WORLD,
+                 MPI_STATUS_IGNORE);
+    MPI_Waitall(world_size, terminate_reqs, MPI_STATUSES_IGNORE);
+    free(terminate_reqs);
+    block_spans_close(&spans);
+
+    result_channel_close(results);
+    return found;
+}
+
+// Benchmark mode: one run of mpi_crack on a target with no hit, or with a
+// hit planted at `plant` (0-1) of the keyspace. Rank 0 prints a summary and
+// one "RESULT," CSV line (see tools/mpi_comm_benchmark.sh).
+void mpi_benchmark(int length, double plant, int rank, int world_size) {
+    unsigned char target_hash[MD5_DIGEST_LENGTH];
+    unsigned long long total = calculate_combinations(length);
+    if (plant >= 0) {
+        char planted[MAX_PASSWORD_LENGTH + 1];
+        number_to_password((unsigned long long)(plant * (total - 1)), planted, length);
+        generate_hash(planted, target_hash);
+    } else {
+        generate_hash("no-hit", target_hash);    // '-' is outside the charset
+    }
+
+    use_potfile = 0;
+    show_progress = 0;
+    result_channel results;
+    result_channel_open(&results, rank, world_size);
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    crack_stats stats;
+    mpi_crack(target_hash, length, rank, world_size, &results, &stats);
+    result_channel_free(&results);
+
+    // Localhost ranks share a clock, so exit times compare with the hit time
+    unsigned long long tried;
+    double loop_time, comm_sum, loop_sum, hit_time, exit_time;
+    MPI_Reduce(&stats.tried, &tried, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&stats.loop_time, &loop_time, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&stats.loop_time, &loop_sum, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&stats.comm_time, &comm_sum, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&stats.hit_time, &hit_time, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&stats.exit_time, &exit_time, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    if (rank != 0)
+        return;
+
+    double latency = hit_time > 0 ? exit_time - hit_time : 0;
+    double rate = tried / loop_time;
+    double mpi_fraction = loop_sum > 0 ? comm_sum / loop_sum : 0;
+    printf("Ranks: %d, length %d, check interval %llu, chunk %llu, communication %s\n",
+           world_size, length, check_interval, chunk_size, communicate ? "on" : "off");
+    printf("Candidates: %llu in %.3f s (%.0f H/s)\n", tried, loop_time, rate);
+    printf("Time in MPI checks: %.3f%%\n", 100.0 * mpi_fraction);
+    if (plant >= 0)
+        printf("Termination latency: %.6f s after the hit%s\n", latency,
+               hit_time > 0 ? "" : " (hit not reached)");
+    printf("RESULT,%d,%d,%llu,%llu,%d,%s,%llu,%.6f,%.0f,%.6f,%.6f\n",
+           world_size, length, check_interval, chunk_size, communicate,
+           plant >= 0 ? "planted" : "no-hit", tried, loop_time, rate, mpi_fraction, latency);
+}
 
-        // ----------- GENERATE GUESS ----------
+// Tail benchmark: the whole keyspace of `length` with no hit, run once with
+// static strides and once with tail splitting, printed side by side. With a
+// slowdown above 1 the last rank hashes every candidate that many times, to
+// stand in for a slow node.
+void mpi_tail_benchmark(int length, int slowdown, int rank, int world_size) {
+    unsigned char target_hash[MD5_DIGEST_LENGTH];
+    generate_hash("no-hit", target_hash);
+    use_potfile = 0;
+    show_progress = 0;
+    straggler_slowdown = slowdown;
+
+    double wall[2], tail[2];
+    unsigned long long splits[2], tried[2];
+    for (int mode = 0; mode < 2; mode++) {
+        speculative_tail = mode;
+        result_channel results;
+        result_channel_open(&results, rank, world_size);
+        MPI_Barrier(MPI_COMM_WORLD);
+        double start = MPI_Wtime();
+
+        crack_stats stats;
+        mpi_crack(target_hash, length, rank, world_size, &results, &stats);
+        result_channel_free(&results);
+
+        // Localhost ranks share a clock: the tail runs from the first rank
+        // out of work to the last one leaving the loop
+        double idle = stats.tail_start > 0 ? stats.tail_start : stats.exit_time, first_idle;
+        MPI_Reduce(&idle, &first_idle, 1, MPI_DOUBLE, MPI_MIN, 0, MPI_COMM_WORLD);
+        double exit_time;
+        MPI_Reduce(&stats.exit_time, &exit_time, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+        MPI_Reduce(&stats.splits, &splits[mode], 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, 0,
+                   MPI_COMM_WORLD);
+        MPI_Reduce(&stats.tried, &tried[mode], 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, 0,
+                   MPI_COMM_WORLD);
+        wall[mode] = exit_time - start;
+        tail[mode] = exit_time - first_idle;
+    }
+    if (rank != 0)
+        return;
+
+    printf("Ranks: %d, length %d, chunk %llu, rank %d slowed %dx\n",
+           world_size, length, chunk_size, world_size - 1, slowdown);
+    printf("%-18s %10s %10s %8s %12s\n", "Tail mitigation", "Wall (s)", "Tail (s)", "Splits",
+           "Candidates");
+    printf("%-18s %10.3f %10.3f %8llu %12llu\n", "off", wall[0], tail[0], splits[0], tried[0]);
+    printf("%-18s %10.3f %10.3f %8llu %12llu\n", "split largest span", wall[1], tail[1],
+           splits[1], tried[1]);
+    printf("Speed-up: %.2fx\n", wall[1] > 0 ? wall[0] / wall[1] : 0);
+}
+
+// ---------------------------------------------
+// TARGET-SHARDED MODE (HASH LIST)
+// ---------------------------------------------
+// Targets are split by digest prefix into `shards` shards. Ranks form
+// columns of `shards` consecutive ranks; inside a column, rank k holds
+// shard k only. Every rank hashes its part of the keyspace once and routes
+// each digest to the column member that owns its prefix, so cluster memory
+// grows with the target set instead of every rank holding all of it.
+//
+// A column works in lockstep, one block of shards * SHARD_BATCH candidates
+// per exchange round. Its leader claims the next block from a counter on
+// rank 0 and broadcasts it, so a slow column simply takes fewer blocks and
+// the tail is at most one round. With --no-speculation, column c takes
+// blocks c, c + columns, ... instead. A second counter holds the hash-file
+// lines cracked so far; each candidate is hashed by one column only, so
+// every line is counted once, and leaders stop when it reaches the total.
+
+#define SHARD_BATCH 65536   // Candidates hashed per rank between exchanges
+#define NOT_CRACKED ULLONG_MAX
+#define BLOCK_NEXT_SLOT 0
+#define CRACKED_LINES_SLOT 1
+
+typedef struct {
+    unsigned char digest[MD5_DIGEST_LENGTH];
+    unsigned long long index;
+} routed_digest;
+
+typedef struct {
+    unsigned char digest[MD5_DIGEST_LENGTH];
+    long long line;                   // Line in the hash file: the target id
+    unsigned long long found_index;   // NOT_CRACKED until a candidate matches
+} shard_target;
+
+int shard_of(const unsigned char *digest, int shards) {
+    unsigned int prefix = ((unsigned int)digest[0] << 24) | (digest[1] << 16) |
+                          (digest[2] << 8) | digest[3];
+    return prefix % shards;
+}
+
+int compare_shard_targets(const void *a, const void *b) {
+    return memcmp(((const shard_target *)a)->digest,
+                  ((const shard_target *)b)->digest, MD5_DIGEST_LENGTH);
+}
+
+// Read the hash file, keeping only the digests that belong to `shard`
+shard_target *load_target_shard(const char *path, int shard, int shards, int *count) {
+    FILE *fp = fopen(path, "r");
+    if (!fp)
+        return NULL;
+
+    int capacity = 1024;
+    shard_target *targets = malloc(capacity * sizeof(shard_target));
+    track_memory(MEM_TARGET_SHARD, capacity * sizeof(shard_target));
+    char line[256];
+    long long line_number = -1;
+    *count = 0;
+
+    while (fgets(line, sizeof(line), fp)) {
+        unsigned char digest[MD5_DIGEST_LENGTH];
+        line_number++;
+        if (strlen(line) < MD5_DIGEST_LENGTH * 2 || !parse_hex_digest(line, digest) ||
+            shard_of(digest, shards) != shard)
+            continue;
+
+        if (*count == capacity) {
+            track_memory(MEM_TARGET_SHARD, capacity * sizeof(shard_target));
+            capacity *= 2;
+            targets = realloc(targets, capacity * sizeof(shard_target));
+        }
+        memcpy(targets[*count].digest, digest, MD5_DIGEST_LENGTH);
+        targets[*count].line = line_number;
+        targets[*count].found_index = NOT_CRACKED;
+        (*count)++;
+    }
+
+    fclose(fp);
+    track_memory(MEM_TARGET_SHARD, -(long long)(capacity - *count - 1) * sizeof(shard_target));
+    targets = realloc(targets, (*count + 1) * sizeof(shard_target));
+    qsort(targets, *count, sizeof(shard_target), compare_shard_targets);
+    return targets;
+}
+
+// Hash candidates [from, to) and bucket the digests by owning column member
+void hash_shard_batch(unsigned long long from, unsigned long long to, int length, int shards,
+                      routed_digest *scratch, routed_digest *send,
+                      int *send_counts, int *send_displs) {
+    char guess[MAX_PASSWORD_LENGTH + 1];
+    int n = 0;
+
+    for (unsigned long long i = from; i < to; i++, n++) {
         number_to_password(i, guess, length);
-        generate_hash(guess, guess_hash);
+        generate_hash(guess, scratch[n].digest);
+        scratch[n].index = i;
+    }
 
-        // ----------- CHECK MATCH ----------
-        if (memcmp(guess_hash, target_hash, MD5_DIGEST_LENGTH) == 0) {
-            
-            printf("\nRank %d FOUND the password!\n", rank);
-            printf("Password = %s\n", guess);
-
-            // Send termination message to all other ranks
-            int flag = 1;
-            for (int p = 0; p < world_size; p++) {
-                if (p != rank) {
-                    MPI_Send(&flag, 1, MPI_INT, p, TERMINATE_TAG, MPI_COMM_WORLD);
+    memset(send_counts, 0, shards * sizeof(int));
+    for (int k = 0; k < n; k++)
+        send_counts[shard_of(scratch[k].digest, shards)]++;
+
+    send_displs[0] = 0;
+    for (int s = 1; s < shards; s++)
+        send_displs[s] = send_displs[s - 1] + send_counts[s - 1];
+
+    int fill[shards];
+    memcpy(fill, send_displs, shards * sizeof(int));
+    for (int k = 0; k < n; k++)
+        send[fill[shard_of(scratch[k].digest, shards)]++] = scratch[k];
+}
+
+// Match routed digests against this rank's shard; new hits go to the writer.
+// Returns the number of hash-file lines newly cracked.
+long long probe_shard(shard_target *targets, int target_count,
+                      const routed_digest *received, int received_count,
+                      result_channel *results) {
+    long long cracked = 0;
+    for (int k = 0; k < received_count; k++) {
+        shard_target *t = bsearch(received[k].digest, targets, target_count,
+                                  sizeof(shard_target), compare_shard_targets);
+        if (!t)
+            continue;
+
+        // Duplicate digests (several hash-file lines) sit next to each other
+        while (t > targets && compare_shard_targets(t - 1, t) == 0)
+            t--;
+        for (; t < targets + target_count &&
+               memcmp(t->digest, received[k].digest, MD5_DIGEST_LENGTH) == 0; t++) {
+            if (t->found_index == NOT_CRACKED) {
+                t->found_index = received[k].index;
+                report_hit(results, t->line, received[k].index);
+                cracked++;
+            }
+        }
+    }
+    return cracked;
+}
+
+// Probe a finished exchange and add its new hits to the count on rank 0
+void settle_shard_batch(shard_target *targets, int target_count, const routed_digest *received,
+                        int received_count, result_channel *results, MPI_Win win) {
+    long long cracked = probe_shard(targets, target_count, received, received_count, results);
+    if (cracked > 0) {
+        MPI_Accumulate(&cracked, 1, MPI_LONG_LONG, 0, CRACKED_LINES_SLOT, 1, MPI_LONG_LONG,
+                       MPI_SUM, win);
+        MPI_Win_flush(0, win);
+    }
+}
+
+// Column leader: the next block for this column, or -1 once the blocks run
+// out or every line is cracked. Broadcast to the rest of the column.
+long long next_shard_block(long long *claimed, long long block_count, int column, int columns,
+                           int total_targets, MPI_Win win) {
+    long long block, cracked, one = 1;
+    if (speculative_tail) {
+        MPI_Fetch_and_op(&one, &block, MPI_LONG_LONG, 0, BLOCK_NEXT_SLOT, MPI_SUM, win);
+    } else {
+        block = column + *claimed * columns;
+    }
+    MPI_Fetch_and_op(NULL, &cracked, MPI_LONG_LONG, 0, CRACKED_LINES_SLOT, MPI_NO_OP, win);
+    MPI_Win_flush(0, win);
+    (*claimed)++;
+    return block < block_count && cracked < total_targets ? block : -1;
+}
+
+int compare_hits(const void *a, const void *b) {
+    const hit_record *x = a, *y = b;
+    if (x->target != y->target)
+        return x->target < y->target ? -1 : 1;
+    return (x->index > y->index) - (x->index < y->index);
+}
+
+// Writer: hits only carry hash-file line numbers, so resolve them with one
+// pass over the file. A target is normally cracked in one column only.
+void write_sharded_hits(result_channel *results, const char *target_path, int length) {
+    qsort(results->deferred, results->deferred_count, sizeof(hit_record), compare_hits);
+
+    FILE *fp = fopen(target_path, "r");
+    char line[256];
+    long long line_number = -1;
+    int k = 0;
+
+    while (fp && k < results->deferred_count && fgets(line, sizeof(line), fp)) {
+        line_number++;
+        if (results->deferred[k].target != line_number)
+            continue;
+
+        unsigned char digest[MD5_DIGEST_LENGTH];
+        char hex[MD5_DIGEST_LENGTH * 2 + 1];
+        char guess[MAX_PASSWORD_LENGTH + 1];
+        parse_hex_digest(line, digest);
+        hash_to_hex(digest, hex);
+        number_to_password(results->deferred[k].index, guess, length);
+        write_hit(results, hex, guess);
+
+        while (k < results->deferred_count && results->deferred[k].target == line_number)
+            k++;
+    }
+
+    if (fp)
+        fclose(fp);
+}
+
+int mpi_crack_sharded(const char *target_path, int length, int shards,
+                      int rank, int world_size, result_channel *results) {
+    int column = rank / shards;
+    int shard = rank % shards;
+
+    // Column: one full set of shards
+    MPI_Comm column_comm;
+    MPI_Comm_split(MPI_COMM_WORLD, column, rank, &column_comm);
+
+    int target_count = 0;
+    shard_target *targets = load_target_shard(target_path, shard, shards, &target_count);
+    if (!targets) {
+        if (rank == 0)
+            printf("Error: Cannot open %s\n", target_path);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    int total_targets = 0;
+    int counted = (column == 0) ? target_count : 0;
+    MPI_Allreduce(&counted, &total_targets, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+
+    unsigned long long total = calculate_combinations(length);
+    unsigned long long block_size = (unsigned long long)shards * SHARD_BATCH;
+    long long block_count = (total + block_size - 1) / block_size;
+    int columns = world_size / shards;
+
+    if (rank == 0) {
+        printf("\n=== Target-Sharded Search (MPI) ===\n");
+        printf("Targets: %d, shards: %d, shard copies: %d\n",
+               total_targets, shards, columns);
+        printf("Combinations: %llu, blocks of %llu: %lld\n", total, block_size, block_count);
+        printf("Tail mitigation: %s\n\n", speculative_tail ? "blocks claimed per round" : "off");
+    }
+
+    // Double-buffered: batch k+1 is hashed while batch k is in flight
+    routed_digest *scratch = malloc(SHARD_BATCH * sizeof(routed_digest));
+    routed_digest *send[2], *recv[2] = { NULL, NULL };
+    int recv_capacity[2] = { 0, 0 };
+    int *send_counts[2], *send_displs[2], *recv_counts[2], *recv_displs[2];
+    int received[2] = { 0, 0 };
+    MPI_Request exchange[2] = { MPI_REQUEST_NULL, MPI_REQUEST_NULL };
+
+    track_memory(MEM_EXCHANGE, 3LL * SHARD_BATCH * sizeof(routed_digest) + 8LL * shards * sizeof(int));
+    for (int b = 0; b < 2; b++) {
+        send[b] = malloc(SHARD_BATCH * sizeof(routed_digest));
+        send_counts[b] = malloc(shards * sizeof(int));
+        send_displs[b] = malloc(shards * sizeof(int));
+        recv_counts[b] = malloc(shards * sizeof(int));
+        recv_displs[b] = malloc(shards * sizeof(int));
+    }
+
+    // Counts and displacements are in units of routed_digest
+    MPI_Datatype entry;
+    MPI_Type_contiguous(sizeof(routed_digest), MPI_BYTE, &entry);
+    MPI_Type_commit(&entry);
+
+    // Block counter and cracked-line count, hosted on rank 0
+    long long *shared;
+    MPI_Win win;
+    MPI_Win_allocate(rank == 0 ? 2 * sizeof(long long) : 0, sizeof(long long), MPI_INFO_NULL,
+                     MPI_COMM_WORLD, &shared, &win);
+    if (rank == 0) {
+        MPI_Win_lock(MPI_LOCK_EXCLUSIVE, 0, 0, win);
+        shared[BLOCK_NEXT_SLOT] = 0;
+        shared[CRACKED_LINES_SLOT] = 0;
+        MPI_Win_unlock(0, win);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    MPI_Win_lock_all(0, win);
+
+    double start = MPI_Wtime();
+    long long claimed = 0;
+    unsigned long long round;
+
+    // The column leaves the loop together, on its leader's broadcast
+    for (round = 0; ; round++) {
+        int b = round % 2;
+
+        long long block = shard == 0 ?
+            next_shard_block(&claimed, block_count, column, columns, total_targets, win) : 0;
+        MPI_Bcast(&block, 1, MPI_LONG_LONG, 0, column_comm);
+        if (block < 0)
+            break;
+
+        unsigned long long from = block * block_size + (unsigned long long)shard * SHARD_BATCH;
+        unsigned long long to = from + SHARD_BATCH < total ? from + SHARD_BATCH : total;
+        hash_shard_batch(from < total ? from : total, to, length, shards, scratch,
+                         send[b], send_counts[b], send_displs[b]);
+
+        // Counts are tiny; the digest payload is exchanged without blocking
+        MPI_Alltoall(send_counts[b], 1, MPI_INT, recv_counts[b], 1, MPI_INT, column_comm);
+
+        received[b] = 0;
+        for (int s = 0; s < shards; s++) {
+            recv_displs[b][s] = received[b];
+            received[b] += recv_counts[b][s];
+        }
+        if (received[b] > recv_capacity[b]) {
+            track_memory(MEM_EXCHANGE, (long long)(received[b] - recv_capacity[b]) * sizeof(routed_digest));
+            recv_capacity[b] = received[b];
+            recv[b] = realloc(recv[b], recv_capacity[b] * sizeof(routed_digest));
+        }
+
+        MPI_Ialltoallv(send[b], send_counts[b], send_displs[b], entry,
+                       recv[b], recv_counts[b], recv_displs[b], entry,
+                       column_comm, &exchange[b]);
+
+        // Probe the previous batch while this one is in flight
+        if (round > 0) {
+            MPI_Wait(&exchange[1 - b], MPI_STATUS_IGNORE);
+            settle_shard_batch(targets, target_count, recv[1 - b], received[1 - b], results, win);
+        }
+        service_hits(results);
+    }
+    double idle = MPI_Wtime();
+
+    // Probe the last batch still in flight
+    if (round > 0) {
+        int last = (round - 1) % 2;
+        MPI_Wait(&exchange[last], MPI_STATUS_IGNORE);
+        settle_shard_batch(targets, target_count, recv[last], received[last], results, win);
+    }
+    MPI_Win_unlock_all(win);
+
+    // Blocks this column hashed, and the tail: first column out of work to the end
+    long long blocks_done = shard == 0 ? (long long)round : 0, total_blocks = 0;
+    double first_idle;
+    MPI_Reduce(&blocks_done, &total_blocks, 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&idle, &first_idle, 1, MPI_DOUBLE, MPI_MIN, 0, MPI_COMM_WORLD);
+    if (rank == 0 && total_blocks < block_count)
+        printf("Every target cracked after %lld of %lld blocks\n", total_blocks, block_count);
+
+    result_channel_close(results);
+    double end = MPI_Wtime();
+
+    if (results->is_writer) {
+        write_sharded_hits(results, target_path, length);
+        printf("\nCracked: %d / %d targets\n", results->written, total_targets);
+        printf("Time elapsed: %.6f seconds\n", end - start);
+        printf("Tail time: %.6f seconds\n", end - first_idle);
+    }
+
+    for (int b = 0; b < 2; b++) {
+        free(send[b]);
+        free(recv[b]);
+        free(send_counts[b]);
+        free(send_displs[b]);
+        free(recv_counts[b]);
+        free(recv_displs[b]);
+    }
+    track_memory(MEM_EXCHANGE, -(3LL * SHARD_BATCH + recv_capacity[0] + recv_capacity[1]) *
+                               (long long)sizeof(routed_digest) - 8LL * shards * sizeof(int));
+    track_memory(MEM_TARGET_SHARD, -(long long)(target_count + 1) * sizeof(shard_target));
+    MPI_Type_free(&entry);
+    MPI_Win_free(&win);
+    free(scratch);
+    free(targets);
+    MPI_Comm_free(&column_comm);
+    return results->written;
+}
+
+// ---------------------------------------------
+// DISTRIBUTED DICTIONARY MODE (MPI-IO)
+// ---------------------------------------------
+// The wordlist stays on shared storage. It is cut into fixed byte ranges;
+// a rank owns every line that *starts* inside its range, so ranges don't
+// need to be newline-aligned on disk. Each rank's first range is read with
+// one collective MPI-IO call; after that, ranks that finish early take the
+// next unclaimed range from a shared counter on rank 0 (one-sided RMA).
+// Once every range is claimed, idle ranks run a second copy of the oldest
+// unfinished range; whichever copy finishes first cancels the other.
+
+#define MAX_RULE_LENGTH 32
+#define MAX_RULES 1024
+#define DICT_RANGE_BYTES (1 << 20)      // Wordlist bytes per work unit
+#define DICT_CHECK_INTERVAL 32768       // Candidates between termination checks
+
+// Rules are applied in order of observed hits per candidate. Counts from
+// earlier runs are kept in RULE_STATS_PATH; every rule still runs on every word.
+#define RULE_STATS_PATH "mpi_password_hash.rulestats"
+#define RULE_PRIOR_TRIED 1000000.0      // An unseen rule scores 1 hit per this many
+
+typedef struct {
+    char rules[MAX_RULES][MAX_RULE_LENGTH + 1];
+    int count;
+    int order[MAX_RULES];                       // Application order, best first
+    unsigned long long past_hits[MAX_RULES];    // From earlier runs
+    unsigned long long past_tried[MAX_RULES];
+    unsigned long long hits[MAX_RULES];         // This run, this rank
+    unsigned long long tried[MAX_RULES];
+} rule_set;
+
+// Window on rank 0: the next unclaimed range, the next straggler candidate,
+// then one state word per range
+#define RANGE_NEXT_SLOT 0
+#define STRAGGLER_NEXT_SLOT 1
+#define RANGE_STATE_SLOT 2
+#define RANGE_DONE 1                    // State bit: set by the first copy to finish
+#define RANGE_COPIED 2                  // State bit: a second copy was started
+
+#define RANGE_CANCELLED 3               // process_dictionary_range: the other copy won
+
+// Built-in rules used when no rules file is given
+static const char *DEFAULT_RULES[] = { ":", "c", "u", "r", "$1", "$!", "c $1", "d" };
+
+// Apply one rule to a word. Supported operations (hashcat syntax):
+//   :  no-op      l  lowercase    u  uppercase    c  capitalize
+//   r  reverse    d  duplicate    $X append X     ^X prepend X
+// Returns the candidate length, or -1 if the rule is invalid or the
+// result does not fit.
+int apply_rule(const char *rule, const char *word, char *out) {
+    char buf[2 * MAX_WORD_LENGTH + 2];
+    int len = strlen(word);
+    if (len > MAX_WORD_LENGTH)
+        return -1;
+    memcpy(buf, word, len + 1);
+
+    for (const char *op = rule; *op; op++) {
+        switch (*op) {
+        case ' ':
+        case ':':
+            break;
+        case 'l':
+            for (int i = 0; i < len; i++)
+                buf[i] = tolower((unsigned char)buf[i]);
+            break;
+        case 'u':
+            for (int i = 0; i < len; i++)
+                buf[i] = toupper((unsigned char)buf[i]);
+            break;
+        case 'c':
+            for (int i = 0; i < len; i++)
+                buf[i] = (i == 0) ? toupper((unsigned char)buf[i]) : tolower((unsigned char)buf[i]);
+            break;
+        case 'r':
+            for (int i = 0; i < len / 2; i++) {
+                char t = buf[i];
+                buf[i] = buf[len - 1 - i];
+                buf[len - 1 - i] = t;
+            }
+            break;
+        case 'd':
+            memcpy(buf + len, buf, len);
+            len *= 2;
+            break;
+        case '$':
+            if (!*++op)
+                return -1;
+            buf[len++] = *op;
+            break;
+        case '^':
+            if (!*++op)
+                return -1;
+            memmove(buf + 1, buf, len);
+            buf[0] = *op;
+            len++;
+            break;
+        default:
+            return -1;
+        }
+        if (len > MAX_WORD_LENGTH)
+            return -1;
+    }
+
+    memcpy(out, buf, len);
+    out[len] = '\0';
+    return len;
+}
+
+// Rank 0 reads the rules file and broadcasts it; returns the rule count,
+// or -1 on every rank if the file cannot be opened
+int load_rules(const char *path, char rules[][MAX_RULE_LENGTH + 1], int rank) {
+    int count = 0;
+
+    if (!path) {
+        count = sizeof(DEFAULT_RULES) / sizeof(DEFAULT_RULES[0]);
+        for (int i = 0; i < count; i++)
+            strcpy(rules[i], DEFAULT_RULES[i]);
+        return count;
+    }
+
+    if (rank == 0) {
+        FILE *fp = fopen(path, "r");
+        char line[256];
+        if (!fp)
+            count = -1;
+        while (fp && count < MAX_RULES && fgets(line, sizeof(line), fp)) {
+            line[strcspn(line, "\r\n")] = '\0';
+            if (line[0] == '\0' || line[0] == '#' || strlen(line) > MAX_RULE_LENGTH)
+                continue;
+            strcpy(rules[count++], line);
+        }
+        if (fp)
+            fclose(fp);
+    }
+
+    MPI_Bcast(&count, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (count > 0)
+        MPI_Bcast(rules, count * (MAX_RULE_LENGTH + 1), MPI_CHAR, 0, MPI_COMM_WORLD);
+    return count;
+}
+
+double rule_score(const rule_set *set, int r) {
+    return (set->past_hits[r] + set->hits[r] + 1.0) /
+           (set->past_tried[r] + set->tried[r] + RULE_PRIOR_TRIED);
+}
+
+// Sort set->order by score, best first; ties keep file order
+void order_rules(rule_set *set) {
+    for (int k = 0; k < set->count; k++) {
+        int r = k, pos = k;
+        double score = rule_score(set, r);
+        while (pos > 0 && rule_score(set, set->order[pos - 1]) < score) {
+            set->order[pos] = set->order[pos - 1];
+            pos--;
+        }
+        set->order[pos] = r;
+    }
+}
+
+// Rank 0 reads "<hits> <tried> <rule>" lines and shares the counts
+void load_rule_stats(rule_set *set, int rank) {
+    memset(set->past_hits, 0, sizeof(set->past_hits));
+    memset(set->past_tried, 0, sizeof(set->past_tried));
+    memset(set->hits, 0, sizeof(set->hits));
+    memset(set->tried, 0, sizeof(set->tried));
+
+    if (rank == 0) {
+        FILE *fp = fopen(RULE_STATS_PATH, "r");
+        char line[256];
+        while (fp && fgets(line, sizeof(line), fp)) {
+            unsigned long long hits, tried;
+            int rule_at = 0;
+            line[strcspn(line, "\r\n")] = '\0';
+            if (sscanf(line, "%llu %llu %n", &hits, &tried, &rule_at) != 2 || rule_at == 0)
+                continue;
+            for (int r = 0; r < set->count; r++) {
+                if (strcmp(set->rules[r], line + rule_at) == 0) {
+                    set->past_hits[r] = hits;
+                    set->past_tried[r] = tried;
                 }
             }
+        }
+        if (fp)
+            fclose(fp);
+    }
 
-            return 1;
+    MPI_Bcast(set->past_hits, set->count, MPI_UNSIGNED_LONG_LONG, 0, MPI_COMM_WORLD);
+    MPI_Bcast(set->past_tried, set->count, MPI_UNSIGNED_LONG_LONG, 0, MPI_COMM_WORLD);
+    order_rules(set);
+}
+
+// Add this run's counts from all ranks to the stats file. Lines for rules
+// not in this set are kept.
+void save_rule_stats(rule_set *set, int rank) {
+    unsigned long long hits[MAX_RULES], tried[MAX_RULES];
+    MPI_Reduce(set->hits, hits, set->count, MPI_UNSIGNED_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(set->tried, tried, set->count, MPI_UNSIGNED_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    if (rank != 0)
+        return;
+
+    FILE *out = fopen(RULE_STATS_PATH ".tmp", "w");
+    if (!out)
+        return;
+    FILE *in = fopen(RULE_STATS_PATH, "r");
+    char line[256];
+    while (in && fgets(line, sizeof(line), in)) {
+        unsigned long long h, t;
+        int rule_at = 0, ours = 0;
+        char rule[256];
+        strcpy(rule, line);
+        rule[strcspn(rule, "\r\n")] = '\0';
+        if (sscanf(rule, "%llu %llu %n", &h, &t, &rule_at) != 2 || rule_at == 0)
+            continue;
+        for (int r = 0; r < set->count && !ours; r++)
+            ours = strcmp(set->rules[r], rule + rule_at) == 0;
+        if (!ours)
+            fputs(line, out);
+    }
+    if (in)
+        fclose(in);
+    for (int r = 0; r < set->count; r++)
+        fprintf(out, "%llu %llu %s\n", set->past_hits[r] + hits[r],
+                set->past_tried[r] + tried[r], set->rules[r]);
+    fclose(out);
+    rename(RULE_STATS_PATH ".tmp", RULE_STATS_PATH);
+}
+
+// Read byte range `range` plus the byte before it and enough bytes after it
+// to finish the last line. Returns the number of bytes read.
+int read_dictionary_range(MPI_File fh, long long range, MPI_Offset file_size,
+                          char *buffer, MPI_Offset *read_from, int collective) {
+    MPI_Offset start = range * (MPI_Offset)DICT_RANGE_BYTES;
+    MPI_Offset end = start + DICT_RANGE_BYTES + MAX_WORD_LENGTH + 1;
+    int count = 0;
+
+    if (start < file_size) {
+        *read_from = (start > 0) ? start - 1 : 0;
+        if (end > file_size)
+            end = file_size;
+        count = end - *read_from;
+    }
+
+    MPI_Status status;
+    if (collective)
+        MPI_File_read_at_all(fh, *read_from, buffer, count, MPI_CHAR, &status);
+    else
+        MPI_File_read_at(fh, *read_from, buffer, count, MPI_CHAR, &status);
+    return count;
+}
+
+// Hits are reported as (0, word offset * MAX_RULES + rule); the writer
+// re-reads the word at that offset and re-applies the rule
+typedef struct {
+    MPI_File fh;
+    MPI_Offset file_size;
+    char (*rules)[MAX_RULE_LENGTH + 1];
+    const unsigned char *target_hash;
+} dictionary_context;
+
+int resolve_dictionary(result_channel *results, const hit_record *hit,
+                       char *hex, char *password) {
+    dictionary_context *ctx = results->context;
+    MPI_Offset offset = hit->index / MAX_RULES;
+    int rule = hit->index % MAX_RULES;
+    char word[MAX_WORD_LENGTH + 2];
+    int count = MAX_WORD_LENGTH + 1;
+
+    if (offset + count > ctx->file_size)
+        count = ctx->file_size - offset;
+    MPI_File_read_at(ctx->fh, offset, word, count, MPI_CHAR, MPI_STATUS_IGNORE);
+    word[count] = '\0';
+    word[strcspn(word, "\r\n")] = '\0';
+
+    hash_to_hex(ctx->target_hash, hex);
+    return apply_rule(ctx->rules[rule], word, password) >= 0;
+}
+
+// Atomically OR `bits` into a range's state on rank 0; returns the old state
+long long update_range_state(MPI_Win win, long long range, long long bits, MPI_Op op) {
+    long long old;
+    MPI_Fetch_and_op(&bits, &old, MPI_LONG_LONG, 0, RANGE_STATE_SLOT + range, op, win);
+    MPI_Win_flush(0, win);
+    return old;
+}
+
+// Claim a second copy of the oldest range that has not finished. Ranges are
+// handed out in order, so a shared cursor walks them oldest first: each one
+// is offered to exactly one idle rank, which skips it if it is already done.
+// Returns -1 when there is none.
+long long claim_straggler(MPI_Win win, long long range_count) {
+    long long one = 1, r;
+    for (;;) {
+        MPI_Fetch_and_op(&one, &r, MPI_LONG_LONG, 0, STRAGGLER_NEXT_SLOT, MPI_SUM, win);
+        MPI_Win_flush(0, win);
+        if (r >= range_count)
+            return -1;
+        if (!(update_range_state(win, r, RANGE_COPIED, MPI_BOR) & RANGE_DONE))
+            return r;
+    }
+}
+
+// Hash every rule applied to every line starting inside the range, one rule
+// at a time across all words, best-scoring rules first. The finder posts a
+// termination message to every other rank in `terminate_reqs`; the others
+// only probe for one here and receive it when the search is settled.
+// Returns 1 if this rank found the password, -1 if another rank did,
+// RANGE_CANCELLED if another copy of the range finished first, else 0.
+int process_dictionary_range(char *buffer, int count, MPI_Offset read_from,
+                             long long range, rule_set *set,
+                             const unsigned char *target_hash,
+                             int rank, int world_size, unsigned long long *tried,
+                             result_channel *results, MPI_Win win,
+                             MPI_Request *terminate_reqs) {
+    static int terminate_signal = 1;
+    // A line takes at least two bytes, newline included
+    static int word_at[DICT_RANGE_BYTES / 2 + 2];
+    MPI_Offset start = range * (MPI_Offset)DICT_RANGE_BYTES;
+    MPI_Offset end = start + DICT_RANGE_BYTES;
+    char guess[MAX_WORD_LENGTH + 1];
+    unsigned char guess_hash[MD5_DIGEST_LENGTH];
+    int pos = 0, words = 0;
+    unsigned long long since_check = 0;
+
+    // The line straddling our start belongs to the previous range
+    if (start > 0) {
+        while (pos < count && buffer[pos] != '\n')
+            pos++;
+        pos++;
+    }
+
+    // Terminate the words in place; the buffer is not needed afterwards
+    while (pos < count && read_from + pos < end) {
+        int line_end = pos;
+        while (line_end < count && buffer[line_end] != '\n')
+            line_end++;
+
+        int len = line_end - pos;
+        if (len > 0 && buffer[line_end - 1] == '\r')
+            len--;
+
+        if (len > 0 && len <= MAX_WORD_LENGTH) {
+            buffer[pos + len] = '\0';
+            word_at[words++] = pos;
+        }
+        pos = line_end + 1;
+    }
+
+    order_rules(set);
+    for (int k = 0; k < set->count; k++) {
+        int r = set->order[k];
+
+        for (int w = 0; w < words; w++) {
+            int guess_len = apply_rule(set->rules[r], buffer + word_at[w], guess);
+            if (guess_len < 0)
+                continue;
+
+            MD5((unsigned char *)guess, guess_len, guess_hash);
+            set->tried[r]++;
+            (*tried)++;
+
+            if (memcmp(guess_hash, target_hash, MD5_DIGEST_LENGTH) == 0) {
+                // Only the first copy of the range to get here reports
+                if (update_range_state(win, range, RANGE_DONE, MPI_BOR) & RANGE_DONE)
+                    return RANGE_CANCELLED;
+
+                set->hits[r]++;
+                report_hit(results, 0, (unsigned long long)(read_from + word_at[w]) * MAX_RULES + r);
+                flush_hits(results);
+
+                for (int p = 0; p < world_size; p++) {
+                    if (p != rank)
+                        MPI_Isend(&terminate_signal, 1, MPI_INT, p, TERMINATE_TAG,
+                                  MPI_COMM_WORLD, &terminate_reqs[p]);
+                }
+                return 1;
+            }
+
+            if (++since_check == DICT_CHECK_INTERVAL) {
+                since_check = 0;
+                service_hits(results);
+
+                int flag = 0;
+                MPI_Iprobe(MPI_ANY_SOURCE, TERMINATE_TAG, MPI_COMM_WORLD, &flag, MPI_STATUS_IGNORE);
+                if (flag)
+                    return -1;
+
+                if (speculative_tail &&
+                    (update_range_state(win, range, 0, MPI_NO_OP) & RANGE_DONE))
+                    return RANGE_CANCELLED;
+            }
         }
     }
 
     return 0;
 }
 
+int mpi_crack_dictionary(const char *wordlist_path, const char *rules_path,
+                         const unsigned char *target_hash, int rank, int world_size,
+                         result_channel *results) {
+    static rule_set set;
+    set.count = load_rules(rules_path, set.rules, rank);
+    if (set.count < 0) {
+        if (rank == 0)
+            printf("Error: Cannot open rules file %s\n", rules_path);
+        result_channel_close(results);
+        return 0;
+    }
+    load_rule_stats(&set, rank);
+
+    MPI_File fh;
+    if (MPI_File_open(MPI_COMM_WORLD, wordlist_path, MPI_MODE_RDONLY,
+                      MPI_INFO_NULL, &fh) != MPI_SUCCESS) {
+        if (rank == 0)
+            printf("Error: Cannot open wordlist %s\n", wordlist_path);
+        result_channel_close(results);
+        return 0;
+    }
+
+    MPI_Offset file_size;
+    MPI_File_get_size(fh, &file_size);
+
+    dictionary_context context = { fh, file_size, set.rules, target_hash };
+    results->resolve = resolve_dictionary;
+    results->context = &context;
+    long long range_count = (file_size + DICT_RANGE_BYTES - 1) / DICT_RANGE_BYTES;
+
+    if (rank == 0) {
+        printf("\n=== Distributed Dictionary Search (MPI-IO) ===\n");
+        printf("Wordlist: %s (%lld bytes, %lld ranges)\n", wordlist_path,
+               (long long)file_size, range_count);
+        printf("Rules: %d, best first:", set.count);
+        for (int k = 0; k < set.count && k < 5; k++)
+            printf(" \"%s\" (%llu/%llu)", set.rules[set.order[k]],
+                   set.past_hits[set.order[k]], set.past_tried[set.order[k]]);
+        printf("\n");
+        printf("Tail mitigation: %s\n\n", speculative_tail ? "duplicate oldest range" : "off");
+    }
+
+    // Range counters and states, hosted on rank 0. Ranges below world_size
+    // are handed out statically in the collective read.
+    long long *shared;
+    MPI_Win win;
+    MPI_Win_allocate(rank == 0 ? (RANGE_STATE_SLOT + range_count) * sizeof(long long) : 0,
+                     sizeof(long long), MPI_INFO_NULL, MPI_COMM_WORLD, &shared, &win);
+    if (rank == 0) {
+        MPI_Win_lock(MPI_LOCK_EXCLUSIVE, 0, 0, win);
+        memset(shared, 0, (RANGE_STATE_SLOT + range_count) * sizeof(long long));
+        shared[RANGE_NEXT_SLOT] = world_size;
+        MPI_Win_unlock(0, win);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    char *buffer = malloc(DICT_RANGE_BYTES + MAX_WORD_LENGTH + 2);
+    long long dictionary_bytes = DICT_RANGE_BYTES + MAX_WORD_LENGTH + 2;
+    track_memory(MEM_DICTIONARY, dictionary_bytes);
+    unsigned long long tried = 0, copy_tried = 0;
+    long long copies = 0, cancelled = 0;
+    MPI_Offset read_from = 0;
+    MPI_Request *terminate_reqs = malloc(world_size * sizeof(MPI_Request));
+    for (int p = 0; p < world_size; p++)
+        terminate_reqs[p] = MPI_REQUEST_NULL;
+
+    // Every rank takes part in the collective read, even with nothing to read
+    int count = read_dictionary_range(fh, rank, file_size, buffer, &read_from, 1);
+
+    MPI_Win_lock_all(0, win);
+    long long range = rank;
+    int copy = 0;
+    int result = range < range_count ? 0 : -2;
+
+    while (result >= 0) {
+        unsigned long long before = tried;
+        result = process_dictionary_range(buffer, count, read_from, range, &set, target_hash,
+                                          rank, world_size, &tried, results, win,
+                                          terminate_reqs);
+        if (copy)
+            copy_tried += tried - before;
+        if (result == RANGE_CANCELLED) {
+            cancelled++;
+        } else if (result == 0) {
+            update_range_state(win, range, RANGE_DONE, MPI_BOR);
+        } else {
+            break;
+        }
+
+        long long one = 1;
+        MPI_Fetch_and_op(&one, &range, MPI_LONG_LONG, 0, RANGE_NEXT_SLOT, MPI_SUM, win);
+        MPI_Win_flush(0, win);
+        copy = 0;
+
+        if (range >= range_count) {
+            if (!speculative_tail || (range = claim_straggler(win, range_count)) < 0)
+                break;
+            copy = 1;
+            copies++;
+        }
+        count = read_dictionary_range(fh, range, file_size, buffer, &read_from, 0);
+    }
+    MPI_Win_unlock_all(win);
+
+    // Settle the termination messages: each finder sent one to every other
+    // rank (the same word can sit in two ranges), and the loop only probed
+    // for them, so every rank receives exactly one per finder but itself
+    int found = result == 1, finders = 0, signal;
+    MPI_Allreduce(&found, &finders, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    for (int k = 0; k < finders - found; k++)
+        MPI_Recv(&signal, 1, MPI_INT, MPI_ANY_SOURCE, TERMINATE_TAG, MPI_COMM_WORLD,
+                 MPI_STATUS_IGNORE);
+    MPI_Waitall(world_size, terminate_reqs, MPI_STATUSES_IGNORE);
+    free(terminate_reqs);
+
+    save_rule_stats(&set, rank);
+
+    unsigned long long total_tried = 0, total_copy_tried = 0;
+    long long total_copies = 0, total_cancelled = 0;
+    MPI_Reduce(&tried, &total_tried, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&copy_tried, &total_copy_tried, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, 0,
+               MPI_COMM_WORLD);
+    MPI_Reduce(&copies, &total_copies, 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&cancelled, &total_cancelled, 1, MPI_LONG_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    if (rank == 0) {
+        printf("\nCandidates tried: %llu\n", total_tried);
+        if (speculative_tail)
+            printf("Speculative copies: %lld ranges, %llu candidates, %lld copies cancelled\n",
+                   total_copies, total_copy_tried, total_cancelled);
+    }
+
+    // The writer may still re-read words, so close before the file
+    result_channel_close(results);
+
+    track_memory(MEM_DICTIONARY, -dictionary_bytes);
+    free(buffer);
+    MPI_Win_free(&win);
+    MPI_File_close(&fh);
+    return result == 1;
+}
+
+// ---------------------------------------------
+// KEYBOARD-WALK MODE
+// ---------------------------------------------
+// The same walk generator as the OpenMP build: walks over a staggered
+// keyboard grid, tried in likelihood order (straight lines first, then one
+// turn, two turns, ...; short before long). Each pass is split by starting
+// key: rank r takes keys r, r + world_size, ... After every pass the ranks
+// agree with MPI_Allreduce whether anyone has found it, so a hit stops the
+// search at the end of its pass and no termination messages are needed.
+
+#define KEYBOARD_ROWS 4
+#define MAX_KEYS 64
+#define WALK_DIRECTIONS 6
+#define MAX_WALK_LENGTH 16
+
+typedef struct {
+    const char *name;
+    const char *rows[KEYBOARD_ROWS];
+} keyboard_layout;
+
+static const keyboard_layout LAYOUTS[] = {
+    { "qwerty", { "1234567890-=", "qwertyuiop[]", "asdfghjkl;'", "zxcvbnm,./" } },
+    { "azerty", { "1234567890-=", "azertyuiop[]", "qsdfghjklm'", "wxcvbn,;:!"  } },
+    { "dvorak", { "1234567890[]", "',.pyfgcrl/=", "aoeuidhtns-", ";qjkxbmwvz"  } },
+};
+#define LAYOUT_COUNT (int)(sizeof(LAYOUTS) / sizeof(LAYOUTS[0]))
+
+// Each row sits half a key right of the one above: up to 6 neighbours
+typedef struct {
+    char key[MAX_KEYS];
+    int neighbour[MAX_KEYS][WALK_DIRECTIONS];   // -1 when there is no key
+    int key_count;
+} keyboard_graph;
+
+typedef struct {
+    const keyboard_graph *graph;
+    const unsigned char *target_hash;
+    int length;
+    int shift_mode;             // 0 = none, 1 = + first key shifted, 2 = + all shifted
+    int found;
+    unsigned long long hit;     // Packed walk, see walk_index
+    unsigned long long attempts;
+} walk_search;
+
+// US shift map for the non-letter keys on the layouts above
+char shift_key(char c) {
+    static const char plain[]   = "1234567890-=[];',./";
+    static const char shifted[] = "!@#$%^&*()_+{}:\"<>?";
+
+    if (c >= 'a' && c <= 'z')
+        return c - 'a' + 'A';
+    const char *p = strchr(plain, c);
+    return p ? shifted[p - plain] : c;
+}
+
+int find_key(const keyboard_layout *layout, int row, int col, const int *row_start) {
+    if (row < 0 || row >= KEYBOARD_ROWS || col < 0 || col >= (int)strlen(layout->rows[row]))
+        return -1;
+    return row_start[row] + col;
+}
+
+void build_keyboard_graph(const keyboard_layout *layout, keyboard_graph *graph) {
+    int row_start[KEYBOARD_ROWS];
+    graph->key_count = 0;
+
+    for (int r = 0; r < KEYBOARD_ROWS; r++) {
+        row_start[r] = graph->key_count;
+        for (int c = 0; layout->rows[r][c]; c++)
+            graph->key[graph->key_count++] = layout->rows[r][c];
+    }
+
+    for (int r = 0; r < KEYBOARD_ROWS; r++) {
+        for (int c = 0; layout->rows[r][c]; c++) {
+            int *n = graph->neighbour[row_start[r] + c];
+            n[0] = find_key(layout, r,     c + 1, row_start);  // right
+            n[1] = find_key(layout, r,     c - 1, row_start);  // left
+            n[2] = find_key(layout, r + 1, c,     row_start);  // down-right
+            n[3] = find_key(layout, r + 1, c - 1, row_start);  // down-left
+            n[4] = find_key(layout, r - 1, c + 1, row_start);  // up-right
+            n[5] = find_key(layout, r - 1, c,     row_start);  // up-left
+        }
+    }
+}
+
+// A hit record carries one walk as bits: shift variant (2), length (5),
+// starting key (6), then 3 bits per step naming its direction (45)
+unsigned long long walk_index(const keyboard_graph *graph, const int *path, int length,
+                              int variant) {
+    unsigned long long index = variant | (unsigned long long)length << 2 |
+                               (unsigned long long)path[0] << 7;
+    for (int i = 1; i < length; i++) {
+        int d = 0;
+        while (graph->neighbour[path[i - 1]][d] != path[i])
+            d++;
+        index |= (unsigned long long)d << (13 + 3 * (i - 1));
+    }
+    return index;
+}
+
+void walk_to_password(const keyboard_graph *graph, unsigned long long index, char *password) {
+    int variant = index & 3;
+    int length = (index >> 2) & 31;
+    int key = (index >> 7) & 63;
+
+    for (int i = 0; i < length; i++) {
+        if (i > 0)
+            key = graph->neighbour[key][(index >> (13 + 3 * (i - 1))) & 7];
+        char c = graph->key[key];
+        password[i] = (variant == 2 || (variant == 1 && i == 0)) ? shift_key(c) : c;
+    }
+    password[length] = '\0';
+}
+
+// Hash one walk and its enabled shift variants
+void try_walk(walk_search *ws, const int *path) {
+    char guess[MAX_WALK_LENGTH + 1];
+    unsigned char guess_hash[MD5_DIGEST_LENGTH];
+
+    for (int v = 0; v <= ws->shift_mode; v++) {
+        int changed = 0;
+        for (int i = 0; i < ws->length; i++) {
+            char c = ws->graph->key[path[i]];
+            guess[i] = (v == 2 || (v == 1 && i == 0)) ? shift_key(c) : c;
+            changed |= (guess[i] != c);
+        }
+        guess[ws->length] = '\0';
+
+        // Skip variants where shifting changed nothing
+        if (v > 0 && !changed)
+            continue;
+
+        generate_hash(guess, guess_hash);
+        ws->attempts++;
+
+        if (memcmp(guess_hash, ws->target_hash, MD5_DIGEST_LENGTH) == 0) {
+            ws->found = 1;
+            ws->hit = walk_index(ws->graph, path, ws->length, v);
+            return;
+        }
+    }
+}
+
+// Extend a walk key by key, spending at most `turns_left` direction changes.
+// Only walks that use exactly the requested number of turns are emitted.
+void extend_walk(walk_search *ws, int *path, int depth, int direction, int turns_left) {
+    if (ws->found)
+        return;
+    if (depth == ws->length) {
+        if (turns_left == 0)
+            try_walk(ws, path);
+        return;
+    }
+
+    for (int d = 0; d < WALK_DIRECTIONS; d++) {
+        int next = ws->graph->neighbour[path[depth - 1]][d];
+        int turn = (direction >= 0 && d != direction);
+        if (next < 0 || turn > turns_left)
+            continue;
+        path[depth] = next;
+        extend_walk(ws, path, depth + 1, d, turns_left - turn);
+    }
+}
+
+typedef struct {
+    const keyboard_graph *graph;
+    const unsigned char *target_hash;
+} walk_context;
+
+int resolve_walk(result_channel *results, const hit_record *hit, char *hex, char *password) {
+    walk_context *ctx = results->context;
+    hash_to_hex(ctx->target_hash, hex);
+    walk_to_password(ctx->graph, hit->index, password);
+    return 1;
+}
+
+int mpi_crack_walks(const unsigned char *target_hash, const keyboard_layout *layout,
+                    int min_length, int max_length, int max_turns, int shift_mode,
+                    int rank, int world_size, result_channel *results) {
+    keyboard_graph graph;
+    build_keyboard_graph(layout, &graph);
+
+    walk_context context = { &graph, target_hash };
+    results->resolve = resolve_walk;
+    results->context = &context;
+
+    if (rank == 0) {
+        printf("\n=== Distributed Keyboard-Walk Search ===\n");
+        printf("Layout: %s (%d keys), walk length: %d-%d, max direction changes: %d, "
+               "shift mode: %d\n", layout->name, graph.key_count, min_length, max_length,
+               max_turns, shift_mode);
+        printf("Starting keys per rank: %d-%d\n\n", graph.key_count / world_size,
+               (graph.key_count + world_size - 1) / world_size);
+    }
+
+    walk_search ws = { &graph, target_hash, 0, shift_mode, 0, 0, 0 };
+    int any_found = 0;
+
+    for (int turns = 0; turns <= max_turns && !any_found; turns++) {
+        for (int length = min_length; length <= max_length && !any_found; length++) {
+            // A walk of `length` keys has room for at most length - 2 turns
+            if (turns > 0 && turns > length - 2)
+                continue;
+
+            ws.length = length;
+            for (int start = rank; start < graph.key_count && !ws.found; start += world_size) {
+                int path[MAX_WALK_LENGTH];
+                path[0] = start;
+                extend_walk(&ws, path, 1, -1, turns);
+            }
+            MPI_Allreduce(&ws.found, &any_found, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+        }
+    }
+
+    if (ws.found)
+        report_hit(results, 0, ws.hit);
+
+    unsigned long long total_attempts = 0;
+    MPI_Reduce(&ws.attempts, &total_attempts, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, 0,
+               MPI_COMM_WORLD);
+    result_channel_close(results);
+
+    if (rank == 0) {
+        printf("%s\n", any_found ? "Password found" : "Password NOT found");
+        printf("Candidates tried: %llu\n", total_attempts);
+    }
+    return ws.found;
+}
+
 // ---------------------------------------------
 // MAIN
 // ---------------------------------------------
@@ -135,6 +2159,200 @@ int main(int argc, char *argv[]) {
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &world_size);
 
+    // --no-speculation: no duplicate copies of straggler ranges, to compare wall times
+    // --report FILE / --metrics FILE: JSON run report / Prometheus metrics from rank 0
+    // --profile FILE [--profile-hz N]: folded stacks per rank in FILE.<rank>
+    // --check-interval N / --chunk N / --no-comm: brute-force loop settings
+    rss_start = MPI_Wtime();
+    while (argc >= 2) {
+        if (strcmp(argv[1], "--no-speculation") == 0) {
+            speculative_tail = 0;
+        } else if (strcmp(argv[1], "--no-comm") == 0) {
+            communicate = 0;
+        } else if (strcmp(argv[1], "--check-interval") == 0 && argc >= 3 && atoll(argv[2]) > 0) {
+            check_interval = atoll(argv[2]);
+            argv++;
+            argc--;
+        } else if (strcmp(argv[1], "--chunk") == 0 && argc >= 3 && atoll(argv[2]) > 0) {
+            chunk_size = atoll(argv[2]);
+            argv++;
+            argc--;
+        } else if (strcmp(argv[1], "--report") == 0 && argc >= 3) {
+            report_path = argv[2];
+            argv++;
+            argc--;
+        } else if (strcmp(argv[1], "--metrics") == 0 && argc >= 3) {
+            metrics_path = argv[2];
+            argv++;
+            argc--;
+        } else if (strcmp(argv[1], "--profile") == 0 && argc >= 3) {
+            profile_path = argv[2];
+            argv++;
+            argc--;
+        } else if (strcmp(argv[1], "--profile-hz") == 0 && argc >= 3 &&
+                   atoi(argv[2]) > 0 && atoi(argv[2]) <= 10000) {
+            profile_hz = atoi(argv[2]);
+            argv++;
+            argc--;
+        } else {
+            break;
+        }
+        argv++;
+        argc--;
+    }
+    if (profile_path)
+        start_profiler();
+
+    // Benchmark mode: mpirun -np N ./mpi_password_hash -B length [plant_fraction]
+    if (argc >= 3 && strcmp(argv[1], "-B") == 0) {
+        int length = atoi(argv[2]);
+        double plant = argc >= 4 ? atof(argv[3]) : -1;
+        if (length < 1 || length > MAX_PASSWORD_LENGTH || plant > 1) {
+            if (rank == 0)
+                printf("Error: length must be 1-%d and the plant fraction 0-1\n", MAX_PASSWORD_LENGTH);
+            MPI_Finalize();
+            return 1;
+        }
+        mpi_benchmark(length, plant, rank, world_size);
+        MPI_Finalize();
+        return 0;
+    }
+
+    // Tail benchmark: mpirun -np N ./mpi_password_hash -T length [slowdown]
+    if (argc >= 3 && strcmp(argv[1], "-T") == 0) {
+        int length = atoi(argv[2]);
+        int slowdown = argc >= 4 ? atoi(argv[3]) : 1;
+        if (length < 1 || length > MAX_PASSWORD_LENGTH || slowdown < 1 || !communicate) {
+            if (rank == 0)
+                printf("Error: length must be 1-%d, the slowdown at least 1, and -T needs the "
+                       "periodic checks (no --no-comm)\n", MAX_PASSWORD_LENGTH);
+            MPI_Finalize();
+            return 1;
+        }
+        mpi_tail_benchmark(length, slowdown, rank, world_size);
+        MPI_Finalize();
+        return 0;
+    }
+
+    // Target-sharded mode: mpirun -np N ./mpi_password_hash -t hashes.txt length [shards]
+    if (argc >= 4 && strcmp(argv[1], "-t") == 0) {
+        int length = atoi(argv[3]);
+        int shards = (argc >= 5) ? atoi(argv[4]) : world_size;
+
+        if (length < 1 || length > MAX_PASSWORD_LENGTH ||
+            shards < 1 || world_size % shards != 0) {
+            if (rank == 0)
+                printf("Error: length must be 1-%d and shards must divide %d ranks\n",
+                       MAX_PASSWORD_LENGTH, world_size);
+            MPI_Finalize();
+            return 1;
+        }
+
+        result_channel results;
+        result_channel_open(&results, rank, world_size);
+        mpi_crack_sharded(argv[2], length, shards, rank, world_size, &results);
+        result_channel_free(&results);
+        write_profile(rank);
+        report_memory("multi-target", rank, world_size);
+        MPI_Finalize();
+        return 0;
+    }
+
+    // Dictionary mode: mpirun -np N ./mpi_password_hash -w wordlist.txt [rules.txt]
+    if (argc >= 3 && strcmp(argv[1], "-w") == 0) {
+        char word[MAX_WORD_LENGTH + 1];
+
+        if (rank == 0) {
+            printf("Enter password to crack: ");
+            fflush(stdout);
+            if (scanf("%55s", word) != 1) {
+                printf("Error reading password.\n");
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+        }
+        MPI_Bcast(word, MAX_WORD_LENGTH + 1, MPI_CHAR, 0, MPI_COMM_WORLD);
+
+        unsigned char target_hash[MD5_DIGEST_LENGTH];
+        generate_hash(word, target_hash);
+
+        result_channel results;
+        result_channel_open(&results, rank, world_size);
+
+        double start = MPI_Wtime();
+        mpi_crack_dictionary(argv[2], argc >= 4 ? argv[3] : NULL, target_hash,
+                             rank, world_size, &results);
+        double end = MPI_Wtime();
+
+        if (rank == 0)
+            printf("Time elapsed: %.6f seconds\n", end - start);
+        result_channel_free(&results);
+        write_profile(rank);
+        report_memory("dictionary", rank, world_size);
+
+        MPI_Finalize();
+        return 0;
+    }
+
+    // Keyboard-walk mode: mpirun -np N ./mpi_password_hash -k [layout] [min] [max] [turns] [shift]
+    if (argc >= 2 && strcmp(argv[1], "-k") == 0) {
+        const char *layout_name = argc >= 3 ? argv[2] : "qwerty";
+        int min_length = argc >= 4 ? atoi(argv[3]) : 4;
+        int max_length = argc >= 5 ? atoi(argv[4]) : 8;
+        int max_turns  = argc >= 6 ? atoi(argv[5]) : 2;
+        int shift_mode = argc >= 7 ? atoi(argv[6]) : 1;
+
+        const keyboard_layout *layout = NULL;
+        for (int i = 0; i < LAYOUT_COUNT; i++)
+            if (strcmp(LAYOUTS[i].name, layout_name) == 0)
+                layout = &LAYOUTS[i];
+
+        const char *error = NULL;
+        if (!layout)
+            error = "Unknown layout (use qwerty, azerty or dvorak)";
+        else if (min_length < 1 || max_length > MAX_WALK_LENGTH || min_length > max_length)
+            error = "Walk length must be within 1-16";
+        else if (max_turns < 0 || max_turns > MAX_WALK_LENGTH - 2)
+            error = "Direction changes must be within 0-14";
+        else if (shift_mode < 0 || shift_mode > 2)
+            error = "Shift mode must be 0, 1 or 2";
+        if (error) {
+            if (rank == 0)
+                printf("Error: %s\n", error);
+            MPI_Finalize();
+            return 1;
+        }
+
+        char word[MAX_WALK_LENGTH + 1];
+        if (rank == 0) {
+            printf("Enter password to crack: ");
+            fflush(stdout);
+            if (scanf("%16s", word) != 1) {
+                printf("Error reading password.\n");
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+        }
+        MPI_Bcast(word, MAX_WALK_LENGTH + 1, MPI_CHAR, 0, MPI_COMM_WORLD);
+
+        unsigned char target_hash[MD5_DIGEST_LENGTH];
+        generate_hash(word, target_hash);
+
+        result_channel results;
+        result_channel_open(&results, rank, world_size);
+
+        double start = MPI_Wtime();
+        mpi_crack_walks(target_hash, layout, min_length, max_length, max_turns, shift_mode,
+                        rank, world_size, &results);
+        double end = MPI_Wtime();
+
+        if (rank == 0)
+            printf("Time elapsed: %.6f seconds\n", end - start);
+        result_channel_free(&results);
+        write_profile(rank);
+        report_memory("keyboard-walk", rank, world_size);
+        MPI_Finalize();
+        return 0;
+    }
+
     char password[MAX_PASSWORD_LENGTH + 1];
 
     // Only rank 0 reads input
@@ -146,6 +2364,7 @@ int main(int argc, char *argv[]) {
             printf("Error reading password.\n");
             MPI_Abort(MPI_COMM_WORLD, 1);
         }
+        printf("\n");
     }
 
     // Broadcast password to all ranks
@@ -157,15 +2376,21 @@ int main(int argc, char *argv[]) {
     unsigned char target_hash[MD5_DIGEST_LENGTH];
     generate_hash(password, target_hash);
 
+    result_channel results;
+    result_channel_open(&results, rank, world_size);
+
     double start = MPI_Wtime();
 
-    mpi_crack(target_hash, length, rank, world_size);
+    mpi_crack(target_hash, length, rank, world_size, &results, NULL);
 
     double end = MPI_Wtime();
 
     if (rank == 0) {
         printf("\nTime elapsed: %.6f seconds\n", end - start);
     }
+    result_channel_free(&results);
+    write_profile(rank);
+    report_memory("brute-force", rank, world_size);
 
     MPI_Finalize();
     return 0;
@@ -1,18 +1,41 @@
 // bruteforce_parallel.c
 // Compile with: gcc -fopenmp openmp_password_hash.c -lssl -lcrypto -o openmp_password_hash
+// (add -rdynamic -fno-omit-frame-pointer for function names in --profile output)
 
+#define _GNU_SOURCE                 // dladdr, SIGEV_THREAD_ID, CPU_SET
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <linux/futex.h>
+#include <openssl/md4.h>
 #include <openssl/md5.h>
+#include <openssl/evp.h>
 #include <omp.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 
 // Configuration
 #define CHARSET "abcdefghijklmnopqrstuvwxyz"
 #define CHARSET_SIZE 26
 #define MAX_PASSWORD_LENGTH 10
 
+// Dictionary modes
+#define MAX_WORD_LENGTH 55          // Longest word that fits one MD5 block
+#define MAX_CASE_LETTERS 24         // At most 2^24 case variants per word
+
 // Convert a number to password string (base-26 conversion)
 void number_to_password(unsigned long long num, char* password, int length) {
     for (int i = length - 1; i >= 0; i--) {
@@ -44,12 +67,903 @@ void generate_hash(const char* password, unsigned char* hash) {
     MD5((unsigned char*)password, strlen(password), hash);
 }
 
+// ----------------------------------------------
+// MEMORY BUDGET
+// ----------------------------------------------
+// Large structures reserve their size against one budget before allocating:
+// --memory MB if given, else the cgroup limit, else physical RAM. When a
+// reservation fails, subsystems that can run with less step down (see
+// LOOKUP_PLANS); the rest report the shortfall and stop.
+
+typedef enum {
+    MEM_TARGETS,
+    MEM_LOOKUP,
+    MEM_PREFILTER,
+    MEM_PROBE_BATCH,
+    MEM_PIPELINE,
+    MEM_WORDLIST,
+    MEM_SCRYPT,
+    MEM_SUBSYSTEMS
+} memory_subsystem;
+
+static const char* MEMORY_NAMES[] = {
+    "targets", "lookup tables", "prefilters", "probe batches", "pipeline rings", "wordlist",
+    "scrypt arenas"
+};
+
+typedef struct {
+    unsigned long long budget;
+    const char* source;
+    unsigned long long used;
+    unsigned long long live[MEM_SUBSYSTEMS];
+    unsigned long long peak[MEM_SUBSYSTEMS];
+    unsigned long long peak_used;
+    int refused;                    // Reservations that did not fit
+} memory_budget;
+
+memory_budget memory;
+
+// Read one number from a file; returns 0 if missing or "max"
+unsigned long long read_limit(const char* path) {
+    FILE* fp = fopen(path, "r");
+    unsigned long long value = 0;
+    if (fp) {
+        if (fscanf(fp, "%llu", &value) != 1) {
+            value = 0;
+        }
+        fclose(fp);
+    }
+    return value;
+}
+
+void init_memory_budget(double megabytes) {
+    unsigned long long physical = (unsigned long long)sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGESIZE);
+    memory.budget = physical;
+    memory.source = "physical memory";
+
+    if (megabytes > 0) {
+        memory.budget = megabytes * (1 << 20);
+        memory.source = "--memory";
+        return;
+    }
+    // cgroup v2, then v1; v1 reports a huge number when unlimited
+    unsigned long long limit = read_limit("/sys/fs/cgroup/memory.max");
+    if (limit == 0) {
+        limit = read_limit("/sys/fs/cgroup/memory/memory.limit_in_bytes");
+    }
+    if (limit > 0 && limit < physical) {
+        memory.budget = limit;
+        memory.source = "cgroup limit";
+    }
+}
+
+unsigned long long memory_available(void) {
+    unsigned long long available;
+    #pragma omp critical(memory)
+    available = memory.used < memory.budget ? memory.budget - memory.used : 0;
+    return available;
+}
+
+// Returns 1 and books `bytes` if they fit in the budget, else 0
+int reserve_memory(memory_subsystem subsystem, unsigned long long bytes) {
+    int ok = 0;
+    #pragma omp critical(memory)
+    {
+        if (memory.used + bytes <= memory.budget) {
+            memory.used += bytes;
+            memory.live[subsystem] += bytes;
+            if (memory.live[subsystem] > memory.peak[subsystem]) {
+                memory.peak[subsystem] = memory.live[subsystem];
+            }
+            if (memory.used > memory.peak_used) {
+                memory.peak_used = memory.used;
+            }
+            ok = 1;
+        } else {
+            memory.refused++;
+        }
+    }
+    return ok;
+}
+
+void release_memory(memory_subsystem subsystem, unsigned long long bytes) {
+    #pragma omp critical(memory)
+    {
+        memory.used -= bytes;
+        memory.live[subsystem] -= bytes;
+    }
+}
+
+// Resident set size over time, from /proc/self/status. The sampler thread
+// halves its sample count and doubles its interval whenever the buffer is
+// full, so long runs keep an even (if coarser) timeline in fixed space.
+#define MAX_RSS_SAMPLES 512
+#define RSS_INTERVAL_MS 50
+
+typedef struct {
+    double seconds[MAX_RSS_SAMPLES];
+    unsigned long long bytes[MAX_RSS_SAMPLES];
+    int count;
+    int interval_ms;
+    unsigned long long peak;
+    volatile int stop;
+    int running;
+    double start;
+    pthread_t thread;
+} rss_sampler;
+
+rss_sampler rss;
+
+// Current and high-water RSS in bytes; returns 0 without /proc
+int read_rss(unsigned long long* current, unsigned long long* high_water) {
+    FILE* fp = fopen("/proc/self/status", "r");
+    if (!fp) {
+        return 0;
+    }
+    char line[128];
+    unsigned long long kb;
+    *current = *high_water = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        if (sscanf(line, "VmRSS: %llu kB", &kb) == 1) {
+            *current = kb << 10;
+        } else if (sscanf(line, "VmHWM: %llu kB", &kb) == 1) {
+            *high_water = kb << 10;
+        }
+    }
+    fclose(fp);
+    return 1;
+}
+
+void sample_rss(void) {
+    unsigned long long current, high_water;
+    if (!read_rss(&current, &high_water)) {
+        return;
+    }
+    if (rss.count == MAX_RSS_SAMPLES) {
+        for (int i = 0; i < MAX_RSS_SAMPLES / 2; i++) {
+            rss.seconds[i] = rss.seconds[2 * i];
+            rss.bytes[i] = rss.bytes[2 * i];
+        }
+        rss.count = MAX_RSS_SAMPLES / 2;
+        rss.interval_ms *= 2;
+    }
+    rss.seconds[rss.count] = omp_get_wtime() - rss.start;
+    rss.bytes[rss.count++] = current;
+    if (current > rss.peak) {
+        rss.peak = current;
+    }
+}
+
+void* rss_sampler_main(void* unused) {
+    (void)unused;
+    while (!rss.stop) {
+        sample_rss();
+        for (int waited = 0; waited < rss.interval_ms && !rss.stop; waited += 10) {
+            usleep(10000);
+        }
+    }
+    return NULL;
+}
+
+void start_rss_sampler(void) {
+    rss.interval_ms = RSS_INTERVAL_MS;
+    rss.start = omp_get_wtime();
+    rss.running = pthread_create(&rss.thread, NULL, rss_sampler_main, NULL) == 0;
+}
+
+void stop_rss_sampler(void) {
+    if (rss.running) {
+        rss.stop = 1;
+        pthread_join(rss.thread, NULL);
+        rss.running = 0;
+        sample_rss();
+    }
+}
+
+void print_memory_report(void) {
+    printf("Memory budget: %.1f MB (%s), peak reserved %.1f MB",
+           memory.budget / 1048576.0, memory.source, memory.peak_used / 1048576.0);
+    if (memory.refused > 0) {
+        printf(", %d reservations refused", memory.refused);
+    }
+    printf("\n");
+    for (int s = 0; s < MEM_SUBSYSTEMS; s++) {
+        if (memory.peak[s] > 0) {
+            printf("  %-14s peak %10.1f MB\n", MEMORY_NAMES[s], memory.peak[s] / 1048576.0);
+        }
+    }
+    unsigned long long current, high_water;
+    if (read_rss(&current, &high_water)) {
+        printf("  %-14s peak %10.1f MB (now %.1f MB)\n", "process RSS",
+               high_water / 1048576.0, current / 1048576.0);
+    }
+}
+
+// ----------------------------------------------
+// RUN REPORTS
+// ----------------------------------------------
+// --report FILE writes a JSON summary and --metrics FILE a Prometheus
+// text-format export when the program exits, whatever the mode.
+
+const char* report_path = NULL;
+const char* metrics_path = NULL;
+const char* report_mode = "brute-force";
+
+void write_json_report(FILE* out, double elapsed, unsigned long long high_water) {
+    fprintf(out, "{\n");
+    fprintf(out, "  \"program\": \"openmp_password_hash\",\n");
+    fprintf(out, "  \"mode\": \"%s\",\n", report_mode);
+    fprintf(out, "  \"threads\": %d,\n", omp_get_max_threads());
+    fprintf(out, "  \"elapsed_seconds\": %.3f,\n", elapsed);
+    fprintf(out, "  \"memory\": {\n");
+    fprintf(out, "    \"budget_bytes\": %llu,\n", memory.budget);
+    fprintf(out, "    \"budget_source\": \"%s\",\n", memory.source);
+    fprintf(out, "    \"peak_reserved_bytes\": %llu,\n", memory.peak_used);
+    fprintf(out, "    \"refused_reservations\": %d,\n", memory.refused);
+    fprintf(out, "    \"subsystems\": {\n");
+    for (int s = 0; s < MEM_SUBSYSTEMS; s++) {
+        fprintf(out, "      \"%s\": { \"live_bytes\": %llu, \"peak_bytes\": %llu }%s\n",
+                MEMORY_NAMES[s], memory.live[s], memory.peak[s],
+                s + 1 < MEM_SUBSYSTEMS ? "," : "");
+    }
+    fprintf(out, "    }\n");
+    fprintf(out, "  },\n");
+    fprintf(out, "  \"rss\": {\n");
+    fprintf(out, "    \"peak_bytes\": %llu,\n", high_water);
+    fprintf(out, "    \"peak_sampled_bytes\": %llu,\n", rss.peak);
+    fprintf(out, "    \"interval_ms\": %d,\n", rss.interval_ms);
+    fprintf(out, "    \"samples\": [");
+    for (int i = 0; i < rss.count; i++) {
+        fprintf(out, "%s[%.3f, %llu]", i ? ", " : "", rss.seconds[i], rss.bytes[i]);
+    }
+    fprintf(out, "]\n");
+    fprintf(out, "  }\n");
+    fprintf(out, "}\n");
+}
+
+void write_metrics(FILE* out, double elapsed, unsigned long long high_water) {
+    fprintf(out, "# HELP password_hash_elapsed_seconds Wall time of the run\n");
+    fprintf(out, "# TYPE password_hash_elapsed_seconds gauge\n");
+    fprintf(out, "password_hash_elapsed_seconds{mode=\"%s\"} %.3f\n", report_mode, elapsed);
+    fprintf(out, "# HELP password_hash_memory_budget_bytes Memory budget of the run\n");
+    fprintf(out, "# TYPE password_hash_memory_budget_bytes gauge\n");
+    fprintf(out, "password_hash_memory_budget_bytes %llu\n", memory.budget);
+    fprintf(out, "# HELP password_hash_memory_live_bytes Bytes reserved per subsystem at exit\n");
+    fprintf(out, "# TYPE password_hash_memory_live_bytes gauge\n");
+    for (int s = 0; s < MEM_SUBSYSTEMS; s++) {
+        fprintf(out, "password_hash_memory_live_bytes{subsystem=\"%s\"} %llu\n",
+                MEMORY_NAMES[s], memory.live[s]);
+    }
+    fprintf(out, "# HELP password_hash_memory_peak_bytes Peak bytes reserved per subsystem\n");
+    fprintf(out, "# TYPE password_hash_memory_peak_bytes gauge\n");
+    for (int s = 0; s < MEM_SUBSYSTEMS; s++) {
+        fprintf(out, "password_hash_memory_peak_bytes{subsystem=\"%s\"} %llu\n",
+                MEMORY_NAMES[s], memory.peak[s]);
+    }
+    fprintf(out, "# HELP password_hash_memory_refused_total Reservations refused by the budget\n");
+    fprintf(out, "# TYPE password_hash_memory_refused_total counter\n");
+    fprintf(out, "password_hash_memory_refused_total %d\n", memory.refused);
+    fprintf(out, "# HELP password_hash_rss_peak_bytes Peak resident set size (VmHWM)\n");
+    fprintf(out, "# TYPE password_hash_rss_peak_bytes gauge\n");
+    fprintf(out, "password_hash_rss_peak_bytes %llu\n", high_water);
+}
+
+// Registered with atexit so every mode's exit path writes the reports
+void write_run_reports(void) {
+    stop_rss_sampler();
+    double elapsed = omp_get_wtime() - rss.start;
+    unsigned long long current = 0, high_water = 0;
+    read_rss(&current, &high_water);
+
+    const char* paths[2] = { report_path, metrics_path };
+    for (int k = 0; k < 2; k++) {
+        if (!paths[k]) {
+            continue;
+        }
+        FILE* out = fopen(paths[k], "w");
+        if (!out) {
+            printf("Warning: Cannot write %s\n", paths[k]);
+            continue;
+        }
+        if (k == 0) {
+            write_json_report(out, elapsed, high_water);
+        } else {
+            write_metrics(out, elapsed, high_water);
+        }
+        fclose(out);
+        printf("%s written to %s\n", k == 0 ? "Run report" : "Metrics", paths[k]);
+    }
+}
+
+// ----------------------------------------------
+// SAMPLING PROFILER
+// ----------------------------------------------
+// --profile FILE arms one CPU-time timer per OpenMP thread (timer_create on
+// CLOCK_THREAD_CPUTIME_ID, delivered to that thread as SIGPROF). The handler
+// only copies the return addresses into the thread's own buffer, so there
+// are no locks and nothing to share. At exit the stacks are symbolized and
+// written as folded stacks ("thread N;main;...;leaf count") for flamegraph.pl.
+
+#define PROFILE_DEFAULT_HZ 99
+#define PROFILE_MAX_THREADS 256
+#define PROFILE_MAX_SAMPLES 8192        // Per thread; later samples are counted as dropped
+#define PROFILE_MAX_DEPTH 32
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid    // Older glibc headers lack the alias
+#endif
+
+typedef struct {
+    void* frames[PROFILE_MAX_SAMPLES][PROFILE_MAX_DEPTH];
+    unsigned char depth[PROFILE_MAX_SAMPLES];
+    volatile int count;
+    volatile int dropped;
+    int thread;
+    timer_t timer;
+} profile_buffer;
+
+const char* profile_path = NULL;
+int profile_hz = PROFILE_DEFAULT_HZ;
+profile_buffer* profile_buffers[PROFILE_MAX_THREADS];
+int profile_threads;
+__thread profile_buffer* my_profile;
+
+void profile_signal(int signal, siginfo_t* info, void* context) {
+    (void)signal; (void)info; (void)context;
+    profile_buffer* buffer = my_profile;
+    if (!buffer) {
+        return;
+    }
+    int n = buffer->count;
+    if (n == PROFILE_MAX_SAMPLES) {
+        buffer->dropped++;
+        return;
+    }
+    buffer->depth[n] = backtrace(buffer->frames[n], PROFILE_MAX_DEPTH);
+    buffer->count = n + 1;
+}
+
+// Called on the thread to be sampled
+void register_profile_thread(int thread) {
+    profile_buffer* buffer = calloc(1, sizeof(profile_buffer));
+    buffer->thread = thread;
+
+    struct sigevent event;
+    memset(&event, 0, sizeof(event));
+    event.sigev_notify = SIGEV_THREAD_ID;
+    event.sigev_signo = SIGPROF;
+    event.sigev_notify_thread_id = syscall(SYS_gettid);
+    if (timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &buffer->timer) != 0) {
+        free(buffer);
+        return;
+    }
+
+    #pragma omp critical(profile)
+    {
+        if (profile_threads < PROFILE_MAX_THREADS) {
+            profile_buffers[profile_threads++] = buffer;
+            my_profile = buffer;
+        }
+    }
+    if (my_profile != buffer) {
+        timer_delete(buffer->timer);
+        free(buffer);
+        return;
+    }
+
+    long interval = 1000000000L / profile_hz;
+    struct itimerspec spec = { { interval / 1000000000L, interval % 1000000000L },
+                               { interval / 1000000000L, interval % 1000000000L } };
+    timer_settime(buffer->timer, 0, &spec, NULL);
+}
+
+void start_profiler(void) {
+    // backtrace() loads the unwinder on first use; do that outside the handler
+    void* warm[1];
+    backtrace(warm, 1);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = profile_signal;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGPROF, &action, NULL);
+
+    // The OpenMP runtime keeps its pool, so these threads run the later
+    // regions. Threads it creates after this (only for a team larger than
+    // omp_get_max_threads(), or nested regions) are not sampled.
+    #pragma omp parallel
+    register_profile_thread(omp_get_thread_num());
+}
+
+void frame_name(void* address, char* name, size_t size) {
+    Dl_info info;
+    if (!dladdr(address, &info)) {
+        snprintf(name, size, "[unknown]");
+    } else if (info.dli_sname) {
+        snprintf(name, size, "%s", info.dli_sname);
+    } else if (info.dli_fname) {
+        // Local symbols (e.g. outlined parallel regions) only resolve to their module
+        const char* base = strrchr(info.dli_fname, '/');
+        snprintf(name, size, "[%s]", base ? base + 1 : info.dli_fname);
+    } else {
+        snprintf(name, size, "[unknown]");
+    }
+}
+
+int compare_strings(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+// Registered with atexit: stop the timers, then fold identical stacks
+void write_profile(void) {
+    signal(SIGPROF, SIG_IGN);
+    for (int t = 0; t < profile_threads; t++) {
+        timer_delete(profile_buffers[t]->timer);
+    }
+
+    int total = 0, dropped = 0;
+    for (int t = 0; t < profile_threads; t++) {
+        total += profile_buffers[t]->count;
+        dropped += profile_buffers[t]->dropped;
+    }
+    char** stacks = malloc((total + 1) * sizeof(char*));
+    int count = 0;
+    size_t stack_size = PROFILE_MAX_DEPTH * 128 + 32;
+
+    for (int t = 0; t < profile_threads; t++) {
+        profile_buffer* buffer = profile_buffers[t];
+        for (int k = 0; k < buffer->count; k++) {
+            char* stack = malloc(stack_size);
+            int length = snprintf(stack, stack_size, "thread %d", buffer->thread);
+            // Outermost frame first; the two innermost are the handler and the signal trampoline
+            for (int f = buffer->depth[k] - 1; f >= 2; f--) {
+                char name[128];
+                frame_name(buffer->frames[k][f], name, sizeof(name));
+                length += snprintf(stack + length, stack_size - length, ";%s", name);
+            }
+            stacks[count++] = stack;
+        }
+    }
+    qsort(stacks, count, sizeof(char*), compare_strings);
+
+    FILE* out = fopen(profile_path, "w");
+    if (!out) {
+        printf("Warning: Cannot write %s\n", profile_path);
+    }
+    for (int k = 0; k < count; ) {
+        int same = 1;
+        while (k + same < count && strcmp(stacks[k], stacks[k + same]) == 0) {
+            same++;
+        }
+        if (out) {
+            fprintf(out, "%s %d\n", stacks[k], same);
+        }
+        for (int j = 0; j < same; j++) {
+            free(stacks[k + j]);
+        }
+        k += same;
+    }
+    free(stacks);
+    if (out) {
+        fclose(out);
+        printf("Profile: %d samples at %d Hz from %d threads (%d dropped) written to %s\n",
+               total, profile_hz, profile_threads, dropped, profile_path);
+    }
+    for (int t = 0; t < profile_threads; t++) {
+        free(profile_buffers[t]);
+    }
+}
+
+// ----------------------------------------------
+// STAGE TIMING
+// ----------------------------------------------
+// --stage-timing N reads the cycle counter around each stage of one
+// multi-target batch (TAIL_STEP candidates) in N, so the hot loop pays for
+// the timing on a small fraction of batches only. Every cycle of a sampled
+// batch lands in exactly one stage; the report divides by the candidates of
+// the sampled batches to get cycles per candidate.
+
+typedef enum {
+    STAGE_GENERATE,
+    STAGE_HASH,
+    STAGE_LOOKUP,
+    STAGE_BOOKKEEPING,          // Step claims and chunk-end checks
+    STAGES
+} loop_stage;
+
+static const char* STAGE_NAMES[] = { "generate", "hash", "lookup", "bookkeeping" };
+
+typedef struct {
+    unsigned long long cycles[STAGES];
+    unsigned long long candidates;  // In sampled batches
+    unsigned long long batches;     // Sampled
+    unsigned long long steps;       // All, sampled or not
+    unsigned long long last;
+} __attribute__((aligned(64))) stage_clock;
+
+int stage_sample = 0;               // Set by --stage-timing; 0 disables
+
+// TSC on x86; nanoseconds elsewhere
+static inline unsigned long long read_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000ULL + now.tv_nsec;
+#endif
+}
+
+// Charge the cycles since the previous mark to `stage`
+static inline void stage_mark(stage_clock* clock, loop_stage stage) {
+    unsigned long long now = read_cycles();
+    clock->cycles[stage] += now - clock->last;
+    clock->last = now;
+}
+
+void print_stage_timing(const stage_clock* clocks, int threads) {
+    stage_clock all;
+    memset(&all, 0, sizeof(all));
+    for (int t = 0; t < threads; t++) {
+        for (int s = 0; s < STAGES; s++) {
+            all.cycles[s] += clocks[t].cycles[s];
+        }
+        all.candidates += clocks[t].candidates;
+        all.batches += clocks[t].batches;
+        all.steps += clocks[t].steps;
+    }
+    if (all.candidates == 0) {
+        printf("Stage timing: no batch sampled (1 in %d)\n", stage_sample);
+        return;
+    }
+
+    printf("Stage timing: %llu of %llu batches sampled (1 in %d), cycles per candidate\n",
+           all.batches, all.steps, stage_sample);
+    printf("  %-7s", "thread");
+    for (int s = 0; s < STAGES; s++) {
+        printf(" %12s", STAGE_NAMES[s]);
+    }
+    printf(" %12s\n", "total");
+    for (int t = 0; t <= threads; t++) {
+        const stage_clock* clock = t < threads ? &clocks[t] : &all;
+        if (clock->candidates == 0) {
+            continue;
+        }
+        unsigned long long total = 0;
+        if (t < threads) {
+            printf("  %-7d", t);
+        } else {
+            printf("  %-7s", "all");
+        }
+        for (int s = 0; s < STAGES; s++) {
+            printf(" %12.1f", (double)clock->cycles[s] / clock->candidates);
+            total += clock->cycles[s];
+        }
+        printf(" %12.1f\n", (double)total / clock->candidates);
+    }
+    unsigned long long total = 0;
+    for (int s = 0; s < STAGES; s++) {
+        total += all.cycles[s];
+    }
+    printf("  %-7s", "share");
+    for (int s = 0; s < STAGES; s++) {
+        printf(" %11.1f%%", 100.0 * all.cycles[s] / total);
+    }
+    printf("\n");
+}
+
+// ----------------------------------------------
+// RESULT RING
+// ----------------------------------------------
+// --ring FILE maps FILE (put it on tmpfs, e.g. /dev/shm) as a shared-memory
+// ring that local clients such as tools/ring_monitor.c map and read without
+// syscalls or copies through the kernel. Multi-target searches publish a
+// progress snapshot every round and a record per hit. Nothing takes a lock:
+// the snapshot is guarded by a sequence counter and each hit slot by the
+// number of the hit it holds, so a reader that falls RING_HITS behind sees
+// the overwritten slots and skips them. Clients sleep on the `wake` futex,
+// which is only signalled while one of them is waiting.
+// The layout must match tools/ring_monitor.c.
+
+#define RING_MAGIC 0x474e4952u      // "RING"
+#define RING_VERSION 1
+#define RING_HITS 4096
+#define RING_ATTACK_TEXT 32
+
+typedef struct {
+    unsigned long long seq;         // Hit number + 1 once the record is complete
+    unsigned long long index;       // Candidate index within the pass
+    unsigned int pass;
+    unsigned char digest[MD5_DIGEST_LENGTH];
+    char password[MAX_PASSWORD_LENGTH + 1];
+} ring_hit;
+
+typedef struct {
+    unsigned int pass;              // Multi-target passes started so far
+    int targets;
+    int cracked;                    // Including targets settled by the ledger
+    char attack[RING_ATTACK_TEXT];
+    unsigned long long completed;   // Candidates of the pass searched so far
+    unsigned long long total;
+    unsigned long long attempts;
+    double elapsed;
+} ring_progress;
+
+typedef struct {
+    unsigned int magic;             // Written last: the ring is ready
+    unsigned int version;
+    unsigned int capacity;
+    int writer_pid;
+    int finished;                   // The writer will publish nothing more
+    unsigned int progress_seq;      // Odd while the snapshot is rewritten
+    ring_progress progress;
+    unsigned long long hit_head;    // Hits published so far
+    unsigned int wake __attribute__((aligned(64)));  // Futex word, bumped per publish
+    unsigned int waiters;           // Clients sleeping on `wake`
+    ring_hit hits[RING_HITS] __attribute__((aligned(64)));
+} result_ring;
+
+result_ring* ring = NULL;           // Set by --ring
+unsigned int ring_pass = 0;
+
+void wake_ring_clients(void) {
+    __atomic_add_fetch(&ring->wake, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&ring->waiters, __ATOMIC_SEQ_CST) > 0) {
+        syscall(SYS_futex, &ring->wake, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+    }
+}
+
+// Registered with atexit: tell clients that no more records will come
+void close_result_ring(void) {
+    __atomic_store_n(&ring->finished, 1, __ATOMIC_RELEASE);
+    wake_ring_clients();
+    munmap(ring, sizeof(result_ring));
+}
+
+// A fresh file each run, so clients of an earlier run keep their own mapping
+int open_result_ring(const char* path) {
+    unlink(path);
+    int fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0 || ftruncate(fd, sizeof(result_ring)) != 0) {
+        printf("Error: Cannot create result ring %s\n", path);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return 0;
+    }
+    void* map = mmap(NULL, sizeof(result_ring), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        printf("Error: Cannot map result ring %s\n", path);
+        return 0;
+    }
+    ring = map;
+    ring->version = RING_VERSION;
+    ring->capacity = RING_HITS;
+    ring->writer_pid = getpid();
+    __atomic_store_n(&ring->magic, RING_MAGIC, __ATOMIC_RELEASE);
+    atexit(close_result_ring);
+    return 1;
+}
+
+void publish_progress(const ring_progress* progress) {
+    if (!ring) {
+        return;
+    }
+    __atomic_store_n(&ring->progress_seq, ring->progress_seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    ring->progress = *progress;
+    __atomic_store_n(&ring->progress_seq, ring->progress_seq + 1, __ATOMIC_RELEASE);
+    wake_ring_clients();
+}
+
+// Callers serialize hits (record_target_hit runs in a critical section)
+void publish_hit(const unsigned char* digest, const char* password, unsigned long long index) {
+    if (!ring) {
+        return;
+    }
+    unsigned long long n = ring->hit_head;
+    ring_hit* slot = &ring->hits[n % RING_HITS];
+    __atomic_store_n(&slot->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    slot->index = index;
+    slot->pass = ring_pass;
+    memcpy(slot->digest, digest, sizeof(slot->digest));
+    strcpy(slot->password, password);
+    __atomic_store_n(&slot->seq, n + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&ring->hit_head, n + 1, __ATOMIC_RELEASE);
+    wake_ring_clients();
+}
+
+// ----------------------------------------------
+// ENGINE SELECTION
+// ----------------------------------------------
+// Each search sizes its team from an estimate of its serial time W, using
+// T(n) = W / n + THREAD_COST * n. THREAD_COST was fitted to the OpenMP
+// scaling run in Graphs/grpahs.py (1.276 s on one thread, 0.289 s on 16).
+// That run stops at "oshan", candidate 6,718,778 of 26^5, so W = 1.31 s is
+// about 5.1e6 MD5/s, and the rest grows by 0.0143 s per thread; 16 threads
+// were no faster than 8. W itself uses this machine's rate, timed once on
+// the calling thread. The team is the smallest n whose modelled time is
+// within 5% of the best n. Jobs of under 0.03 s therefore run inline, and
+// larger ones get more threads roughly as sqrt(W). --threads N turns this off.
+
+#define THREAD_RATE_FALLBACK 5.1e6  // MD5/s on one thread in the fitted run
+#define THREAD_COST 0.0143          // Seconds per extra thread, fitted as above
+#define CALIBRATION_HASHES 8192     // About 2 ms on one thread
+#define DISTRIBUTED_SECONDS 600     // Suggest the MPI build above this
+
+int fixed_threads = 0;              // Set by --threads N
+
+// MD5 candidates per second on one thread, measured on first use
+double thread_hash_rate(void) {
+    static double rate = 0;
+    if (rate == 0) {
+        char guess[MAX_PASSWORD_LENGTH + 1];
+        unsigned char guess_hash[MD5_DIGEST_LENGTH];
+        volatile unsigned char sink = 0;
+        double start = omp_get_wtime();
+        for (int i = 0; i < CALIBRATION_HASHES; i++) {
+            number_to_password(i, guess, 8);
+            generate_hash(guess, guess_hash);
+            sink ^= guess_hash[0];
+        }
+        double elapsed = omp_get_wtime() - start;
+        rate = elapsed > 0 ? CALIBRATION_HASHES / elapsed : THREAD_RATE_FALLBACK;
+    }
+    return rate;
+}
+
+// Cost of one candidate relative to one MD5: lookup work grows slowly
+// with the number of targets, about 0.2 at 10^5 (see --stage-timing)
+double target_lookup_cost(int live) {
+    int bits = live > 1 ? 32 - __builtin_clz((unsigned int)live) : 0;
+    return 1 + 0.05 + 0.01 * bits;
+}
+
+// Smallest team within 5% of the best modelled time for `serial` seconds
+int modelled_threads(double serial, int available) {
+    double best = serial + THREAD_COST;
+    for (int n = 2; n <= available; n++) {
+        double modelled = serial / n + THREAD_COST * n;
+        best = modelled < best ? modelled : best;
+    }
+    int threads = 1;
+    while (threads < available && serial / threads + THREAD_COST * threads > 1.05 * best) {
+        threads++;
+    }
+    return threads;
+}
+
+// `cost` is the work per candidate relative to one MD5
+int choose_threads(unsigned long long candidates, double cost) {
+    int available = omp_get_max_threads();
+    if (fixed_threads) {
+        return available;
+    }
+
+    double serial = candidates * cost / thread_hash_rate();
+    int threads = modelled_threads(serial, available);
+
+    if (threads == 1 && available > 1) {
+        printf("Engine: inline (estimated %.3f s on one thread)\n", serial);
+    } else {
+        printf("Engine: %d of %d threads (estimated %.3f s on one thread)\n", threads, available,
+               serial);
+    }
+    if (serial / threads > DISTRIBUTED_SECONDS) {
+        printf("Engine: about %.0f minutes on this machine; mpi/mpi_password_hash can spread "
+               "this keyspace over several nodes\n", serial / threads / 60);
+    }
+    return threads;
+}
+
+// ----------------------------------------------
+// TAIL SPLITTING
+// ----------------------------------------------
+// Once a round has no unassigned candidates left, idle threads take the
+// upper half of the oldest chunk still being worked on. Nothing runs twice,
+// so there is nothing to cancel. Used by the brute-force and multi-target
+// searches; --no-speculation turns it off to compare wall times.
+
+#define TAIL_CHUNK (1ULL << 14)     // Candidates claimed from a round at a time
+#define TAIL_STEP 1024              // Owners re-read their chunk end this often
+
+int speculative_tail = 1;           // Cleared by --no-speculation
+
+// A thread's current chunk. Thieves lower `end`; the lock keeps the owner's
+// current step and the stolen half from overlapping.
+typedef struct {
+    unsigned long long next;
+    unsigned long long end;
+    double claimed_at;
+    omp_lock_t lock;
+} tail_chunk;
+
+// Take the next step of the calling thread's chunk; returns 0 when it is used up
+int next_tail_step(tail_chunk* chunk, unsigned long long* from, unsigned long long* to) {
+    omp_set_lock(&chunk->lock);
+    *from = chunk->next;
+    *to = chunk->next + TAIL_STEP < chunk->end ? chunk->next + TAIL_STEP : chunk->end;
+    chunk->next = *to;
+    omp_unset_lock(&chunk->lock);
+    return *from < *to;
+}
+
+// Give thread `self` new work: a fresh chunk while the round has any, then the
+// upper half of the oldest chunk with at least two steps left.
+// Returns 0 when the round is finished for this thread.
+int claim_tail_chunk(tail_chunk* chunks, int threads, int self, unsigned long long* cursor,
+                     unsigned long long end, double* tail_start, unsigned long long* splits) {
+    unsigned long long start;
+    #pragma omp atomic capture
+    { start = *cursor; *cursor += TAIL_CHUNK; }
+
+    if (start < end) {
+        omp_set_lock(&chunks[self].lock);
+        chunks[self].next = start;
+        chunks[self].end = start + TAIL_CHUNK < end ? start + TAIL_CHUNK : end;
+        chunks[self].claimed_at = omp_get_wtime();
+        omp_unset_lock(&chunks[self].lock);
+        return 1;
+    }
+    // Exactly one thread sees the first cursor value past the end
+    if (start - end < TAIL_CHUNK) {
+        *tail_start = omp_get_wtime();
+    }
+    if (!speculative_tail) {
+        return 0;
+    }
+
+    while (1) {
+        int victim = -1;
+        double oldest = 0;
+        for (int t = 0; t < threads; t++) {
+            if (t == self) {
+                continue;
+            }
+            omp_set_lock(&chunks[t].lock);
+            if (chunks[t].end - chunks[t].next >= 2 * TAIL_STEP &&
+                (victim < 0 || chunks[t].claimed_at < oldest)) {
+                victim = t;
+                oldest = chunks[t].claimed_at;
+            }
+            omp_unset_lock(&chunks[t].lock);
+        }
+        if (victim < 0) {
+            return 0;
+        }
+
+        // The victim may have moved on since the scan; check again under its lock
+        unsigned long long from = 0, to = 0;
+        omp_set_lock(&chunks[victim].lock);
+        unsigned long long remaining = chunks[victim].end - chunks[victim].next;
+        if (remaining >= 2 * TAIL_STEP) {
+            from = chunks[victim].next + remaining / 2;
+            to = chunks[victim].end;
+            chunks[victim].end = from;
+        }
+        omp_unset_lock(&chunks[victim].lock);
+
+        if (from < to) {
+            omp_set_lock(&chunks[self].lock);
+            chunks[self].next = from;
+            chunks[self].end = to;
+            chunks[self].claimed_at = omp_get_wtime();
+            omp_unset_lock(&chunks[self].lock);
+            #pragma omp atomic
+            (*splits)++;
+            return 1;
+        }
+    }
+}
+
 // ----------------------------------------------
 // PARALLEL BRUTE FORCE USING OPENMP
 // ----------------------------------------------
 int crack_password_parallel(const char* target_password, int password_length) {
     unsigned long long total_combinations = calculate_combinations(password_length);
-    int found = 0;
+    volatile int found = 0;
     unsigned long long found_at = 0;
     char found_password[MAX_PASSWORD_LENGTH + 1];
     unsigned long long attempts = 0;
@@ -69,57 +983,77 @@ int crack_password_parallel(const char* target_password, int password_length) {
     printf("Target hash (MD5): %s\n", target_hash_hex);
     printf("Password length: %d\n", password_length);
     printf("Character set: %s\n", CHARSET);
-    printf("Threads: %d\n", omp_get_max_threads());
-    printf("Total combinations: %llu\n\n", total_combinations);
+    int threads = choose_threads(total_combinations, 1);
+    printf("Threads: %d\n", threads);
+    printf("Total combinations: %llu\n", total_combinations);
+    printf("Tail mitigation: %s\n\n", speculative_tail ? "split oldest chunk" : "off");
+
+    tail_chunk* chunks = calloc(threads, sizeof(tail_chunk));
+    for (int t = 0; t < threads; t++) {
+        omp_init_lock(&chunks[t].lock);
+    }
+    unsigned long long cursor = 0, splits = 0;
+    double tail_start = 0;
 
     // PARALLEL REGION
-    #pragma omp parallel
+    #pragma omp parallel num_threads(threads)
     {
         char guess[MAX_PASSWORD_LENGTH + 1];
         unsigned char guess_hash[MD5_DIGEST_LENGTH];
         unsigned long long local_attempts = 0;
+        int self = omp_get_thread_num();
+        unsigned long long from, to;
 
-        #pragma omp for schedule(dynamic)
-        for (unsigned long long i = 0; i < total_combinations; i++) {
-
-            if (found) {
-                #pragma omp cancel for
-            }
+        while (!found && claim_tail_chunk(chunks, threads, self, &cursor, total_combinations,
+                                          &tail_start, &splits)) {
+            while (!found && next_tail_step(&chunks[self], &from, &to)) {
+                for (unsigned long long i = from; i < to; i++) {
+                    number_to_password(i, guess, password_length);
+                    generate_hash(guess, guess_hash);
+                    local_attempts++;
 
-            number_to_password(i, guess, password_length);
-            generate_hash(guess, guess_hash);
-            local_attempts++;
+                    if (memcmp(guess_hash, target_hash, MD5_DIGEST_LENGTH) == 0) {
+                        #pragma omp critical
+                        {
+                            found = 1;
+                            found_at = i;
+                            strcpy(found_password, guess);
+                        }
+                        break;
+                    }
+                }
 
-            if (memcmp(guess_hash, target_hash, MD5_DIGEST_LENGTH) == 0) {
-                found = 1;
-                found_at = i;
-                strcpy(found_password, guess);
-                #pragma omp cancel for
-            }
+                // Progress indicator (about every 10000 attempts)
+                if (local_attempts >= 10000) {
+                    #pragma omp atomic
+                    attempts += local_attempts;
+                    local_attempts = 0;
 
-            // Progress indicator (every 10000 attempts)
-            if (local_attempts % 10000 == 0) {
-                #pragma omp atomic
-                attempts += local_attempts;
-                local_attempts = 0;
-                
-                #pragma omp critical
-                {
-                    printf("Progress: %llu / %llu attempts (%.2f%%)\r", 
-                           attempts, total_combinations, 
-                           (attempts * 100.0) / total_combinations);
-                    fflush(stdout);
+                    #pragma omp critical
+                    {
+                        printf("Progress: %llu / %llu attempts (%.2f%%)\r",
+                               attempts, total_combinations,
+                               (attempts * 100.0) / total_combinations);
+                        fflush(stdout);
+                    }
                 }
             }
         }
-        
+
         // Add remaining local attempts
         #pragma omp atomic
         attempts += local_attempts;
     }
 
+    for (int t = 0; t < threads; t++) {
+        omp_destroy_lock(&chunks[t].lock);
+    }
+    free(chunks);
+
     double end_time = omp_get_wtime();
     double elapsed = end_time - start_time;
+    // From the first thread finding the round empty to the end
+    double tail_time = tail_start > 0 ? end_time - tail_start : 0;
 
     if (found) {
         char found_hash_hex[MD5_DIGEST_LENGTH * 2 + 1];
@@ -131,20 +1065,3549 @@ int crack_password_parallel(const char* target_password, int password_length) {
         printf("Found at attempt: %llu\n", found_at + 1);
         printf("Execution time: %.3f seconds\n", elapsed);
         printf("Passwords per second: %.0f\n", attempts / elapsed);
+        printf("Tail time: %.3f seconds (%llu chunk splits)\n", tail_time, splits);
         return 1;
     }
 
     printf("\n✗ Password NOT found\n");
     printf("Total attempts: %llu\n", attempts);
     printf("Execution time: %.3f seconds\n", elapsed);
+    printf("Tail time: %.3f seconds (%llu chunk splits)\n", tail_time, splits);
     return 0;
 }
 
-int main() {
-    printf("========================================\n");
-    printf("Parallel Brute Force Password Cracker\n");
-    printf("Using MD5 + OpenMP\n");
-    printf("========================================\n");
+// ----------------------------------------------
+// CASE-PERMUTATION MODE (DICTIONARY WORDS)
+// ----------------------------------------------
+
+// Load a newline-separated wordlist into memory; NULL (after an error
+// message) if it cannot be opened or has no room in the memory budget
+char** load_wordlist(const char* path, int* count) {
+    FILE* fp = fopen(path, "r");
+    if (!fp) {
+        printf("Error: Cannot open wordlist %s\n", path);
+        return NULL;
+    }
+
+    int capacity = 1024;
+    if (!reserve_memory(MEM_WORDLIST, capacity * sizeof(char*))) {
+        printf("Error: No room for a wordlist in the memory budget\n");
+        fclose(fp);
+        return NULL;
+    }
+    char** words = malloc(capacity * sizeof(char*));
+    char line[1024];
+    *count = 0;
+
+    while (fgets(line, sizeof(line), fp)) {
+        size_t len = strcspn(line, "\r\n");
+        int complete = line[len] != '\0' || feof(fp);
+        line[len] = '\0';
+
+        // A line longer than the buffer is one (too long) word: drop the rest
+        if (!complete) {
+            int c;
+            while ((c = fgetc(fp)) != EOF && c != '\n') {
+            }
+            continue;
+        }
+
+        // Skip empty lines and words that don't fit a single MD5 block
+        if (len == 0 || len > MAX_WORD_LENGTH) {
+            continue;
+        }
+
+        if (*count == capacity &&
+            reserve_memory(MEM_WORDLIST, capacity * sizeof(char*))) {
+            capacity *= 2;
+            words = realloc(words, capacity * sizeof(char*));
+        }
+        if (*count == capacity || !reserve_memory(MEM_WORDLIST, len + 1)) {
+            printf("Warning: Wordlist truncated to %d words by the memory budget\n", *count);
+            break;
+        }
+        words[(*count)++] = strdup(line);
+    }
+
+    fclose(fp);
+    release_memory(MEM_WORDLIST, (capacity - *count) * sizeof(char*));
+    return realloc(words, (*count + 1) * sizeof(char*));
+}
+
+void free_wordlist(char** words, int count) {
+    for (int i = 0; i < count; i++) {
+        release_memory(MEM_WORDLIST, strlen(words[i]) + 1);
+        free(words[i]);
+    }
+    release_memory(MEM_WORDLIST, count * sizeof(char*));
+    free(words);
+}
+
+// Try every upper/lower variant of a word's letters.
+// The word is laid out once in lowercase; the variants are then walked in
+// Gray-code order, so each step flips exactly one letter with XOR 0x20
+// instead of rebuilding the candidate. Returns 1 on match, 0 if not found,
+// -1 if the word has too many letters to enumerate.
+int try_case_variants(const char* word, const unsigned char* target_hash,
+                      volatile int* found, char* found_password,
+                      unsigned long long* attempts) {
+    char guess[MAX_WORD_LENGTH + 1];
+    int letter_pos[MAX_WORD_LENGTH];
+    int length = strlen(word);
+    int letters = 0;
+    unsigned char guess_hash[MD5_DIGEST_LENGTH];
+
+    for (int i = 0; i < length; i++) {
+        guess[i] = tolower((unsigned char)word[i]);
+        if (guess[i] >= 'a' && guess[i] <= 'z') {
+            letter_pos[letters++] = i;
+        }
+    }
+    guess[length] = '\0';
+
+    if (letters > MAX_CASE_LETTERS) {
+        return -1;
+    }
+
+    unsigned long long variants = 1ULL << letters;
+
+    for (unsigned long long mask = 0; mask < variants; mask++) {
+        // Gray code: variant `mask` differs from the previous one in bit ctz(mask)
+        if (mask > 0) {
+            guess[letter_pos[__builtin_ctzll(mask)]] ^= 0x20;
+        }
+
+        MD5((unsigned char*)guess, length, guess_hash);
+        (*attempts)++;
+
+        if (memcmp(guess_hash, target_hash, MD5_DIGEST_LENGTH) == 0) {
+            #pragma omp critical
+            {
+                if (!*found) {
+                    *found = 1;
+                    strcpy(found_password, guess);
+                }
+            }
+            return 1;
+        }
+
+        // Another thread may have found it while we walk a long word
+        if ((mask & 4095) == 4095 && *found) {
+            return 0;
+        }
+    }
+
+    return 0;
+}
+
+int crack_case_permutations(const char* target_password, const char* wordlist_path) {
+    int word_count = 0;
+    char** words = load_wordlist(wordlist_path, &word_count);
+    if (!words) {
+        return 0;
+    }
+
+    volatile int found = 0;
+    char found_password[MAX_WORD_LENGTH + 1];
+    unsigned long long attempts = 0;
+    int skipped = 0;
+
+    unsigned char target_hash[MD5_DIGEST_LENGTH];
+    generate_hash(target_password, target_hash);
+
+    char target_hash_hex[MD5_DIGEST_LENGTH * 2 + 1];
+    hash_to_hex(target_hash, target_hash_hex);
+
+    printf("\n=== Starting Case-Permutation Search (OpenMP) ===\n");
+    printf("Target password: %s\n", target_password);
+    printf("Target hash (MD5): %s\n", target_hash_hex);
+    printf("Wordlist: %s (%d words)\n", wordlist_path, word_count);
+
+    // Size the team by the number of variants, 2^letters per word
+    unsigned long long variants = 0;
+    for (int w = 0; w < word_count; w++) {
+        int letters = 0;
+        for (const char* c = words[w]; *c; c++) {
+            letters += isalpha((unsigned char)*c) != 0;
+        }
+        variants += letters <= MAX_CASE_LETTERS ? 1ULL << letters : 0;
+    }
+    int threads = choose_threads(variants, 1);
+    printf("Threads: %d\n\n", threads);
+
+    double start_time = omp_get_wtime();
+
+    // One word per iteration keeps a word's whole variant set on one thread
+    #pragma omp parallel for schedule(dynamic) num_threads(threads) reduction(+:attempts, skipped)
+    for (int w = 0; w < word_count; w++) {
+        if (found) {
+            continue;
+        }
+        if (try_case_variants(words[w], target_hash, &found,
+                              found_password, &attempts) < 0) {
+            skipped++;
+        }
+    }
+
+    double elapsed = omp_get_wtime() - start_time;
+
+    if (skipped > 0) {
+        printf("Skipped %d words with more than %d letters\n", skipped, MAX_CASE_LETTERS);
+    }
+
+    free_wordlist(words, word_count);
+    print_memory_report();
+
+    if (found) {
+        printf("✓ PASSWORD FOUND!\n");
+        printf("Password: %s\n", found_password);
+        printf("Hash: %s\n", target_hash_hex);
+        printf("Candidates tried: %llu\n", attempts);
+        printf("Execution time: %.3f seconds\n", elapsed);
+        printf("Passwords per second: %.0f\n", attempts / elapsed);
+        return 1;
+    }
+
+    printf("✗ Password NOT found\n");
+    printf("Total attempts: %llu\n", attempts);
+    printf("Execution time: %.3f seconds\n", elapsed);
+    return 0;
+}
+
+// ----------------------------------------------
+// KEYBOARD-WALK MODE
+// ----------------------------------------------
+
+#define KEYBOARD_ROWS 4
+#define MAX_KEYS 64
+#define WALK_DIRECTIONS 6
+#define MAX_WALK_LENGTH 16
+
+typedef struct {
+    const char* name;
+    const char* rows[KEYBOARD_ROWS];
+} keyboard_layout;
+
+static const keyboard_layout LAYOUTS[] = {
+    { "qwerty", { "1234567890-=", "qwertyuiop[]", "asdfghjkl;'", "zxcvbnm,./" } },
+    { "azerty", { "1234567890-=", "azertyuiop[]", "qsdfghjklm'", "wxcvbn,;:!"  } },
+    { "dvorak", { "1234567890[]", "',.pyfgcrl/=", "aoeuidhtns-", ";qjkxbmwvz"  } },
+};
+#define LAYOUT_COUNT (int)(sizeof(LAYOUTS) / sizeof(LAYOUTS[0]))
+
+// Keys on a staggered grid: each row sits half a key right of the one above,
+// so every key has up to 6 neighbours (left, right and two above/below)
+typedef struct {
+    char key[MAX_KEYS];
+    int neighbour[MAX_KEYS][WALK_DIRECTIONS];  // -1 when there is no key
+    int key_count;
+} keyboard_graph;
+
+// Per-search state shared by the recursive walk
+typedef struct {
+    const keyboard_graph* graph;
+    const unsigned char* target_hash;
+    int length;
+    int shift_mode;           // 0 = none, 1 = + first key shifted, 2 = + all shifted
+    volatile int* found;
+    char* found_password;
+    unsigned long long attempts;
+} walk_search;
+
+// US shift map for the non-letter keys on the layouts above
+char shift_key(char c) {
+    static const char plain[]   = "1234567890-=[];',./";
+    static const char shifted[] = "!@#$%^&*()_+{}:\"<>?";
+
+    if (c >= 'a' && c <= 'z') {
+        return c - 'a' + 'A';
+    }
+    const char* p = strchr(plain, c);
+    return p ? shifted[p - plain] : c;
+}
+
+int find_key(const keyboard_layout* layout, int row, int col, const int* row_start) {
+    if (row < 0 || row >= KEYBOARD_ROWS || col < 0 ||
+        col >= (int)strlen(layout->rows[row])) {
+        return -1;
+    }
+    return row_start[row] + col;
+}
+
+void build_keyboard_graph(const keyboard_layout* layout, keyboard_graph* graph) {
+    int row_start[KEYBOARD_ROWS];
+    graph->key_count = 0;
+
+    for (int r = 0; r < KEYBOARD_ROWS; r++) {
+        row_start[r] = graph->key_count;
+        for (int c = 0; layout->rows[r][c]; c++) {
+            graph->key[graph->key_count++] = layout->rows[r][c];
+        }
+    }
+
+    for (int r = 0; r < KEYBOARD_ROWS; r++) {
+        for (int c = 0; layout->rows[r][c]; c++) {
+            int* n = graph->neighbour[row_start[r] + c];
+            n[0] = find_key(layout, r,     c + 1, row_start);  // right
+            n[1] = find_key(layout, r,     c - 1, row_start);  // left
+            n[2] = find_key(layout, r + 1, c,     row_start);  // down-right
+            n[3] = find_key(layout, r + 1, c - 1, row_start);  // down-left
+            n[4] = find_key(layout, r - 1, c + 1, row_start);  // up-right
+            n[5] = find_key(layout, r - 1, c,     row_start);  // up-left
+        }
+    }
+}
+
+// Hash one walk and its enabled shift variants
+void try_walk(walk_search* ws, const int* path) {
+    char guess[MAX_WALK_LENGTH + 1];
+    unsigned char guess_hash[MD5_DIGEST_LENGTH];
+    int variants = ws->shift_mode + 1;
+
+    for (int v = 0; v < variants; v++) {
+        int changed = 0;
+        for (int i = 0; i < ws->length; i++) {
+            char c = ws->graph->key[path[i]];
+            guess[i] = (v == 2 || (v == 1 && i == 0)) ? shift_key(c) : c;
+            changed |= (guess[i] != c);
+        }
+        guess[ws->length] = '\0';
+
+        // Skip variants where shifting changed nothing
+        if (v > 0 && !changed) {
+            continue;
+        }
+
+        MD5((unsigned char*)guess, ws->length, guess_hash);
+        ws->attempts++;
+
+        if (memcmp(guess_hash, ws->target_hash, MD5_DIGEST_LENGTH) == 0) {
+            #pragma omp critical
+            {
+                if (!*ws->found) {
+                    *ws->found = 1;
+                    strcpy(ws->found_password, guess);
+                }
+            }
+            return;
+        }
+    }
+}
+
+// Extend a walk key by key, spending at most `turns_left` direction changes.
+// Only walks that use exactly the requested number of turns are emitted.
+void extend_walk(walk_search* ws, int* path, int depth, int direction, int turns_left) {
+    if (*ws->found) {
+        return;
+    }
+    if (depth == ws->length) {
+        if (turns_left == 0) {
+            try_walk(ws, path);
+        }
+        return;
+    }
+
+    int key = path[depth - 1];
+    for (int d = 0; d < WALK_DIRECTIONS; d++) {
+        int next = ws->graph->neighbour[key][d];
+        if (next < 0) {
+            continue;
+        }
+        int turn = (direction >= 0 && d != direction);
+        if (turn > turns_left) {
+            continue;
+        }
+        path[depth] = next;
+        extend_walk(ws, path, depth + 1, d, turns_left - turn);
+    }
+}
+
+// Number of walks of `length` keys with exactly `turns` direction changes,
+// counted by dynamic programming over (key, last direction, turns left)
+// instead of walking them: ways[k][d][t] completes a walk from key k.
+unsigned long long count_walks(const keyboard_graph* graph, int length, int turns) {
+    static unsigned long long ways[2][MAX_KEYS][WALK_DIRECTIONS + 1][MAX_WALK_LENGTH + 1];
+    memset(ways, 0, sizeof(ways));
+    for (int k = 0; k < graph->key_count; k++) {
+        for (int d = 0; d <= WALK_DIRECTIONS; d++) {
+            ways[0][k][d][0] = 1;
+        }
+    }
+
+    for (int step = 1; step < length; step++) {
+        unsigned long long (*from)[WALK_DIRECTIONS + 1][MAX_WALK_LENGTH + 1] = ways[(step - 1) % 2];
+        unsigned long long (*to)[WALK_DIRECTIONS + 1][MAX_WALK_LENGTH + 1] = ways[step % 2];
+        for (int k = 0; k < graph->key_count; k++) {
+            for (int d = 0; d <= WALK_DIRECTIONS; d++) {     // WALK_DIRECTIONS: no direction yet
+                for (int t = 0; t <= turns; t++) {
+                    unsigned long long sum = 0;
+                    for (int e = 0; e < WALK_DIRECTIONS; e++) {
+                        int next = graph->neighbour[k][e];
+                        int turn = d < WALK_DIRECTIONS && e != d;
+                        if (next >= 0 && turn <= t) {
+                            sum += from[next][e][t - turn];
+                        }
+                    }
+                    to[k][d][t] = sum;
+                }
+            }
+        }
+    }
+
+    unsigned long long total = 0;
+    for (int k = 0; k < graph->key_count; k++) {
+        total += ways[(length - 1) % 2][k][WALK_DIRECTIONS][turns];
+    }
+    return total;
+}
+
+int crack_keyboard_walks(const char* target_password, const char* layout_name,
+                         int min_length, int max_length, int max_turns, int shift_mode) {
+    const keyboard_layout* layout = NULL;
+    for (int i = 0; i < LAYOUT_COUNT; i++) {
+        if (strcmp(LAYOUTS[i].name, layout_name) == 0) {
+            layout = &LAYOUTS[i];
+        }
+    }
+    if (!layout) {
+        printf("Error: Unknown layout %s (use qwerty, azerty or dvorak)\n", layout_name);
+        return 0;
+    }
+
+    keyboard_graph graph;
+    build_keyboard_graph(layout, &graph);
+
+    volatile int found = 0;
+    char found_password[MAX_WALK_LENGTH + 1];
+    unsigned long long attempts = 0;
+
+    unsigned char target_hash[MD5_DIGEST_LENGTH];
+    generate_hash(target_password, target_hash);
+
+    char target_hash_hex[MD5_DIGEST_LENGTH * 2 + 1];
+    hash_to_hex(target_hash, target_hash_hex);
+
+    printf("\n=== Starting Keyboard-Walk Search (OpenMP) ===\n");
+    printf("Target password: %s\n", target_password);
+    printf("Target hash (MD5): %s\n", target_hash_hex);
+    printf("Layout: %s (%d keys)\n", layout->name, graph.key_count);
+    printf("Walk length: %d-%d, max direction changes: %d, shift mode: %d\n",
+           min_length, max_length, max_turns, shift_mode);
+
+    // Every walk is hashed once per shift variant (fewer when shifting changes nothing)
+    unsigned long long walks = 0;
+    for (int turns = 0; turns <= max_turns; turns++) {
+        for (int length = min_length; length <= max_length; length++) {
+            walks += turns > 0 && turns > length - 2 ? 0 : count_walks(&graph, length, turns);
+        }
+    }
+    int threads = choose_threads(walks * (shift_mode + 1), 1);
+    printf("Threads: %d\n\n", threads);
+
+    double start_time = omp_get_wtime();
+
+    // Most likely walks first: straight lines before walks that turn,
+    // short before long. Each pass is split across threads by starting key.
+    for (int turns = 0; turns <= max_turns && !found; turns++) {
+        for (int length = min_length; length <= max_length && !found; length++) {
+            // A walk of `length` keys has room for at most length - 2 turns
+            if (turns > 0 && turns > length - 2) {
+                continue;
+            }
+
+            #pragma omp parallel for schedule(dynamic) num_threads(threads) reduction(+:attempts)
+            for (int start = 0; start < graph.key_count; start++) {
+                walk_search ws = { &graph, target_hash, length, shift_mode,
+                                   &found, found_password, 0 };
+                int path[MAX_WALK_LENGTH];
+                path[0] = start;
+                extend_walk(&ws, path, 1, -1, turns);
+                attempts += ws.attempts;
+            }
+        }
+    }
+
+    double elapsed = omp_get_wtime() - start_time;
+
+    if (found) {
+        printf("✓ PASSWORD FOUND!\n");
+        printf("Password: %s\n", found_password);
+        printf("Hash: %s\n", target_hash_hex);
+        printf("Candidates tried: %llu\n", attempts);
+        printf("Execution time: %.3f seconds\n", elapsed);
+        printf("Passwords per second: %.0f\n", attempts / elapsed);
+        return 1;
+    }
+
+    printf("✗ Password NOT found\n");
+    printf("Total attempts: %llu\n", attempts);
+    printf("Execution time: %.3f seconds\n", elapsed);
+    return 0;
+}
+
+// ----------------------------------------------
+// LONG PASSPHRASE MODE (TWO MD5 BLOCKS)
+// ----------------------------------------------
+
+#define MAX_PASSPHRASE_LENGTH 119   // Longest message that fits two MD5 blocks
+#define MAX_NTLM_PASSPHRASE_LENGTH 59   // Two MD4 blocks of UTF-16LE
+#define PASSPHRASE_CHUNK 1024           // Candidates a thread claims at a time
+#define MD5_BLOCK_SIZE 64
+
+// NTLM hashes the UTF-16LE form of the text with MD4. Passphrases are taken
+// as ASCII, so each character widens to itself and a zero byte.
+void widen_utf16le(const char* text, int length, unsigned char* wide) {
+    for (int i = 0; i < length; i++) {
+        wide[2 * i] = (unsigned char)text[i];
+        wide[2 * i + 1] = 0;
+    }
+}
+
+// Brute-force the last `suffix_length` characters (a-z) of a passphrase whose
+// leading part is known. The MD5 (or NTLM's MD4) state after the known part
+// is computed once and copied per candidate, so when the known part covers
+// the first 64-byte block only the second block is compressed for each guess.
+int crack_passphrase_parallel(const char* target_passphrase, int suffix_length, int ntlm) {
+    int length = strlen(target_passphrase);
+    int prefix_length = length - suffix_length;
+    unsigned long long total_combinations = calculate_combinations(suffix_length);
+    volatile int found = 0;
+    unsigned long long found_at = 0;
+    char found_password[MAX_PASSPHRASE_LENGTH + 1];
+    unsigned long long attempts = 0;
+
+    // NTLM hashes two bytes per character
+    int width = ntlm ? 2 : 1;
+    unsigned char wide[2 * MAX_NTLM_PASSPHRASE_LENGTH];
+    widen_utf16le(target_passphrase, ntlm ? length : 0, wide);
+
+    unsigned char target_hash[MD5_DIGEST_LENGTH];
+    if (ntlm) {
+        MD4(wide, 2 * length, target_hash);
+    } else {
+        generate_hash(target_passphrase, target_hash);
+    }
+
+    char target_hash_hex[MD5_DIGEST_LENGTH * 2 + 1];
+    hash_to_hex(target_hash, target_hash_hex);
+
+    // Cache the compression state of the shared leading part
+    MD5_CTX prefix_ctx;
+    MD4_CTX prefix_ntlm;
+    if (ntlm) {
+        MD4_Init(&prefix_ntlm);
+        MD4_Update(&prefix_ntlm, wide, 2 * prefix_length);
+    } else {
+        MD5_Init(&prefix_ctx);
+        MD5_Update(&prefix_ctx, target_passphrase, prefix_length);
+    }
+
+    int message_bytes = width * length;
+    int cached_bytes = width * prefix_length;
+    printf("\n=== Starting Passphrase Search (OpenMP) ===\n");
+    printf("Target passphrase: %s\n", target_passphrase);
+    printf("Target hash (%s): %s\n", ntlm ? "NTLM" : "MD5", target_hash_hex);
+    printf("Passphrase length: %d (%d %s blocks)\n", length,
+           (message_bytes + 8) / MD5_BLOCK_SIZE + 1, ntlm ? "MD4" : "MD5");
+    printf("Known prefix: %d chars, brute-forced suffix: %d chars\n", prefix_length, suffix_length);
+    printf("Cached first block: %s\n", cached_bytes >= MD5_BLOCK_SIZE ? "yes" : "no");
+    // Each guess compresses only the blocks after the cached prefix
+    int blocks = (message_bytes + 8) / MD5_BLOCK_SIZE + 1 - cached_bytes / MD5_BLOCK_SIZE;
+    int threads = choose_threads(total_combinations, blocks);
+    printf("Threads: %d\n", threads);
+    printf("Total combinations: %llu\n\n", total_combinations);
+
+    double start_time = omp_get_wtime();
+    unsigned long long next_chunk = 0;
+
+    #pragma omp parallel num_threads(threads) reduction(+:attempts)
+    {
+        char suffix[MAX_PASSWORD_LENGTH + 1];
+        unsigned char wide_suffix[2 * MAX_PASSWORD_LENGTH];
+        unsigned char guess_hash[MD5_DIGEST_LENGTH];
+        MD5_CTX ctx;
+        MD4_CTX ntlm_ctx;
+
+        // Claim chunks until the keyspace runs out or any thread finds it
+        while (!found) {
+            unsigned long long from;
+            #pragma omp atomic capture
+            { from = next_chunk; next_chunk += PASSPHRASE_CHUNK; }
+            if (from >= total_combinations) {
+                break;
+            }
+            unsigned long long to = total_combinations - from > PASSPHRASE_CHUNK ?
+                                    from + PASSPHRASE_CHUNK : total_combinations;
+
+            for (unsigned long long i = from; i < to && !found; i++) {
+                number_to_password(i, suffix, suffix_length);
+
+                if (ntlm) {
+                    widen_utf16le(suffix, suffix_length, wide_suffix);
+                    ntlm_ctx = prefix_ntlm;
+                    MD4_Update(&ntlm_ctx, wide_suffix, 2 * suffix_length);
+                    MD4_Final(guess_hash, &ntlm_ctx);
+                } else {
+                    ctx = prefix_ctx;
+                    MD5_Update(&ctx, suffix, suffix_length);
+                    MD5_Final(guess_hash, &ctx);
+                }
+                attempts++;
+
+                if (memcmp(guess_hash, target_hash, MD5_DIGEST_LENGTH) == 0) {
+                    #pragma omp critical
+                    {
+                        found = 1;
+                        found_at = i;
+                        memcpy(found_password, target_passphrase, prefix_length);
+                        strcpy(found_password + prefix_length, suffix);
+                    }
+                }
+            }
+        }
+    }
+
+    double elapsed = omp_get_wtime() - start_time;
+
+    if (found) {
+        printf("✓ PASSWORD FOUND!\n");
+        printf("Passphrase: %s\n", found_password);
+        printf("Hash: %s\n", target_hash_hex);
+        printf("Found at attempt: %llu\n", found_at + 1);
+        printf("Execution time: %.3f seconds\n", elapsed);
+        printf("Passwords per second: %.0f\n", attempts / elapsed);
+        return 1;
+    }
+
+    printf("✗ Password NOT found\n");
+    printf("Total attempts: %llu\n", attempts);
+    printf("Execution time: %.3f seconds\n", elapsed);
+    return 0;
+}
+
+// ----------------------------------------------
+// MASKS
+// ----------------------------------------------
+// hashcat-style masks, one charset per position:
+//   ?l a-z   ?u A-Z   ?d 0-9   ?s symbols   ?a all four   ?? a literal '?'
+// Any other character stands for itself. A plain number N is N times ?l.
+// Candidates are numbered with the last position varying fastest, so a
+// mask of ?l only enumerates in the same order as number_to_password.
+
+#define MASK_LOWER "abcdefghijklmnopqrstuvwxyz"
+#define MASK_UPPER "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+#define MASK_DIGITS "0123456789"
+#define MASK_SYMBOLS " !\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~"
+#define MASK_ALL MASK_LOWER MASK_UPPER MASK_DIGITS MASK_SYMBOLS
+#define MAX_MASK_TEXT (2 * MAX_PASSWORD_LENGTH)
+
+typedef struct {
+    int length;
+    const char* sets[MAX_PASSWORD_LENGTH];
+    int sizes[MAX_PASSWORD_LENGTH];
+    char literals[MAX_PASSWORD_LENGTH][2];
+    char text[MAX_MASK_TEXT + 1];
+} candidate_mask;
+
+// Parse a mask (or a plain length). Returns 0 if it is malformed, longer
+// than MAX_PASSWORD_LENGTH positions, or its keyspace does not fit 64 bits.
+int parse_mask(const char* text, candidate_mask* mask) {
+    char expanded[MAX_MASK_TEXT + 1];
+    int n = atoi(text);
+    if (n > 0 && strspn(text, "0123456789") == strlen(text)) {
+        if (n > MAX_PASSWORD_LENGTH) {
+            return 0;
+        }
+        for (int i = 0; i < n; i++) {
+            memcpy(expanded + 2 * i, "?l", 2);
+        }
+        expanded[2 * n] = '\0';
+        text = expanded;
+    }
+    if (strlen(text) > MAX_MASK_TEXT) {
+        return 0;
+    }
+
+    mask->length = 0;
+    unsigned long long keyspace = 1;
+    for (const char* c = text; *c; c++) {
+        if (mask->length == MAX_PASSWORD_LENGTH) {
+            return 0;
+        }
+        const char* set = NULL;
+        if (*c == '?') {
+            c++;
+            switch (*c) {
+                case 'l': set = MASK_LOWER; break;
+                case 'u': set = MASK_UPPER; break;
+                case 'd': set = MASK_DIGITS; break;
+                case 's': set = MASK_SYMBOLS; break;
+                case 'a': set = MASK_ALL; break;
+                case '?': break;
+                default: return 0;
+            }
+        }
+        int p = mask->length++;
+        if (!set) {
+            mask->literals[p][0] = *c;
+            mask->literals[p][1] = '\0';
+            set = mask->literals[p];
+        }
+        mask->sets[p] = set;
+        mask->sizes[p] = strlen(set);
+        if (keyspace > ~0ULL / mask->sizes[p]) {
+            return 0;               // Keyspace does not fit 64 bits
+        }
+        keyspace *= mask->sizes[p];
+    }
+    strcpy(mask->text, text);
+    return mask->length > 0;
+}
+
+unsigned long long mask_keyspace(const candidate_mask* mask) {
+    unsigned long long total = 1;
+    for (int p = 0; p < mask->length; p++) {
+        total *= mask->sizes[p];
+    }
+    return total;
+}
+
+// Candidate `index` of the mask; `digits` (optional) receives each position's
+// index into its charset for next_mask_candidate
+void mask_to_password(unsigned long long index, const candidate_mask* mask,
+                      char* password, int* digits) {
+    for (int p = mask->length - 1; p >= 0; p--) {
+        int d = index % mask->sizes[p];
+        index /= mask->sizes[p];
+        password[p] = mask->sets[p][d];
+        if (digits) {
+            digits[p] = d;
+        }
+    }
+    password[mask->length] = '\0';
+}
+
+// Step to the following candidate, odometer style: no divisions per candidate
+static inline void next_mask_candidate(const candidate_mask* mask, int* digits, char* password) {
+    for (int p = mask->length - 1; p >= 0; p--) {
+        if (++digits[p] < mask->sizes[p]) {
+            password[p] = mask->sets[p][digits[p]];
+            return;
+        }
+        digits[p] = 0;
+        password[p] = mask->sets[p][0];
+    }
+}
+
+// Multi-threaded MD5 rate over 8-character candidates, for sizing mask sets
+// (see tools/mask_generator.c)
+double benchmark_hash_rate(double seconds) {
+    candidate_mask mask;
+    parse_mask("8", &mask);
+    unsigned long long total = 0;
+    double start = omp_get_wtime();
+
+    #pragma omp parallel reduction(+:total)
+    {
+        char guess[MAX_PASSWORD_LENGTH + 1];
+        unsigned char guess_hash[MD5_DIGEST_LENGTH];
+        int digits[MAX_PASSWORD_LENGTH];
+        mask_to_password((unsigned long long)omp_get_thread_num() << 32, &mask, guess, digits);
+
+        while (omp_get_wtime() - start < seconds) {
+            for (int i = 0; i < 65536; i++) {
+                generate_hash(guess, guess_hash);
+                next_mask_candidate(&mask, digits, guess);
+            }
+            total += 65536;
+        }
+    }
+
+    return total / (omp_get_wtime() - start);
+}
+
+// ----------------------------------------------
+// MULTI-TARGET MODE (HASH LIST)
+// ----------------------------------------------
+
+#define ARRAY_LOOKUP_MAX 64         // Up to this many: compare against a flat array
+#define TABLE_LOOKUP_MAX 100000     // Up to this many: open-addressed table alone
+#define MULTI_TARGET_CHUNK (1ULL << 20)
+
+// Partitioned probing for tables far larger than the last-level cache
+#ifndef PARTITIONED_PROBE_MIN_BYTES
+#define PARTITIONED_PROBE_MIN_BYTES (64ULL << 20)  // Table size that enables it
+#endif
+#define PROBE_PARTITION_BYTES (256 << 10)          // Table bytes per partition (~L2)
+#define PROBE_BATCH_SIZE (1 << 16)                 // Candidates gathered per flush
+
+#define MAX_NUMA_NODES 8
+
+// Attack ledger: one line per (algorithm, attack, target set) with the
+// keyspace prefix already searched; per-target outcomes go in a side file
+#define LEDGER_SAVE_SECONDS 10.0    // Progress is saved at most this often
+#define LEDGER_LIST_MAX 20          // Settled targets listed at startup
+
+const char* ledger_path = NULL;     // Set by --ledger PATH; off by default
+
+typedef struct {
+    unsigned char digest[MD5_DIGEST_LENGTH];
+    int cracked;
+    int settled;                    // Outcome already known from the ledger
+    char password[MAX_PASSWORD_LENGTH + 1];
+    double cracked_at;              // omp_get_wtime() of the crack, for trace replay
+    int next_alias;                 // Next target with the same digest, or -1
+    int duplicate;                  // A lower id has the same digest: not in lookups
+} target_entry;
+
+// How candidate digests are matched against the live targets.
+// The cheapest structure that fits the live target count is picked.
+typedef enum {
+    LOOKUP_SINGLE,          // 1 target: one word compare, then full compare
+    LOOKUP_ARRAY,           // 2-64: scan a small L1-resident array of first words
+    LOOKUP_TABLE,           // thousands: open-addressed table
+    LOOKUP_BITMAP_TABLE     // millions: bitmap prefilter in front of the table
+} lookup_strategy;
+
+static const char* LOOKUP_NAMES[] = { "single compare", "array scan",
+                                      "open-addressed table", "bitmap prefilter + table" };
+
+// Table slot: the first digest word is kept inline so a probe only touches
+// the table itself; the target entry is read on a key match
+typedef struct {
+    unsigned int key;
+    int id;                     // -1 when empty
+} table_slot;
+
+typedef struct {
+    lookup_strategy strategy;
+    int count;                  // Live targets held by the structure
+    unsigned int* first_words;  // SINGLE/ARRAY: first digest word per target
+    int* ids;                   // SINGLE/ARRAY: target id per entry
+    table_slot* slots;          // TABLE: open-addressed, linear probing
+    unsigned int slot_mask;
+    int partition_shift;        // Slot index >> shift = probe partition
+    int partition_count;        // > 1 when batched partitioned probing is on
+    unsigned long long* bitmap; // BITMAP: one bit per second-digest-word bucket
+    unsigned int bitmap_mask;
+    lookup_strategy tier;       // Strategy the live count asks for, before any plan step
+    unsigned long long table_bytes;      // Reserved against the memory budget
+    unsigned long long prefilter_bytes;
+} target_lookup;
+
+// Degradation steps, tried in order until the lookups fit the memory budget
+typedef struct {
+    const char* name;
+    int prefilter_bits;         // Bitmap bits per target; 0 drops the prefilter
+    int load_percent;           // Highest table load factor
+    int replicate;              // One replica per NUMA node, or one shared
+} lookup_plan;
+
+static const lookup_plan LOOKUP_PLANS[] = {
+    { "full",                       16, 50, 1 },
+    { "smaller prefilter",           8, 50, 1 },
+    { "one shared lookup",           8, 50, 0 },
+    { "denser table",                8, 75, 0 },
+    { "no prefilter",                0, 90, 0 },
+};
+#define LOOKUP_PLAN_COUNT (int)(sizeof(LOOKUP_PLANS) / sizeof(LOOKUP_PLANS[0]))
+#define LOOKUP_BUILD_COST 0.05  // MD5s per target per replica, timed at 2*10^5 targets
+
+unsigned int digest_word(const unsigned char* digest, int word) {
+    unsigned int value;
+    memcpy(&value, digest + word * 4, sizeof(value));
+    return value;
+}
+
+// Smallest power of two >= n, at most 2^63
+unsigned long long next_power_of_two(unsigned long long n) {
+    unsigned long long p = 1;
+    while (p < n && p < 1ULL << 63) {
+        p <<= 1;
+    }
+    return p;
+}
+
+int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+int parse_hex_digest(const char* hex, unsigned char* digest) {
+    for (int i = 0; i < MD5_DIGEST_LENGTH; i++) {
+        int high = hex_value(hex[i * 2]);
+        int low = hex_value(hex[i * 2 + 1]);
+        if (high < 0 || low < 0) {
+            return 0;
+        }
+        digest[i] = (high << 4) | low;
+    }
+    return 1;
+}
+
+// Next digest of a hash list: one hex digest per line, or raw 16-byte
+// records in a .bin file (see tools/target_generator.c). Returns 0 at EOF;
+// *valid is 0 for a text line without a digest.
+int read_target_digest(FILE* fp, int binary, unsigned char* digest, int* valid) {
+    if (binary) {
+        *valid = 1;
+        return fread(digest, MD5_DIGEST_LENGTH, 1, fp) == 1;
+    }
+    char line[256];
+    if (!fgets(line, sizeof(line), fp)) {
+        return 0;
+    }
+    *valid = strlen(line) >= MD5_DIGEST_LENGTH * 2 && parse_hex_digest(line, digest);
+    return 1;
+}
+
+int* sort_target_ids(const target_entry* targets, int count);   // See ATTACK LEDGER
+
+// Chain the copies of each duplicated digest from the lowest id, so lookups
+// hold one entry per digest and a hit cracks every copy. Returns the number
+// of duplicates.
+int link_target_aliases(target_entry* targets, int count) {
+    int* sorted = sort_target_ids(targets, count);
+    int duplicates = 0;
+    for (int i = 0; i < count; i++) {
+        targets[i].next_alias = -1;
+        targets[i].duplicate = 0;
+    }
+    // Equal digests sort next to each other; ids within a run are unordered
+    for (int i = 0, run = 0; i <= count; i++) {
+        if (i < count && memcmp(targets[sorted[i]].digest, targets[sorted[run]].digest,
+                                MD5_DIGEST_LENGTH) == 0) {
+            continue;
+        }
+        int first = sorted[run];
+        for (int k = run + 1; k < i; k++) {
+            first = sorted[k] < first ? sorted[k] : first;
+        }
+        for (int k = run; k < i; k++) {
+            if (sorted[k] != first) {
+                targets[sorted[k]].duplicate = 1;
+                targets[sorted[k]].next_alias = targets[first].next_alias;
+                targets[first].next_alias = sorted[k];
+                duplicates++;
+            }
+        }
+        run = i;
+    }
+    free(sorted);
+    return duplicates;
+}
+
+// Load a hash list (see read_target_digest); malformed lines are skipped
+target_entry* load_targets(const char* path, int* count) {
+    size_t path_length = strlen(path);
+    int binary = path_length > 4 && strcmp(path + path_length - 4, ".bin") == 0;
+    FILE* fp = fopen(path, binary ? "rb" : "r");
+    if (!fp) {
+        return NULL;
+    }
+
+    int capacity = 1024;
+    if (!reserve_memory(MEM_TARGETS, capacity * sizeof(target_entry))) {
+        printf("Error: No room for a hash list in the memory budget\n");
+        fclose(fp);
+        return NULL;
+    }
+    target_entry* targets = malloc(capacity * sizeof(target_entry));
+    unsigned char digest[MD5_DIGEST_LENGTH];
+    int valid;
+    *count = 0;
+
+    while (read_target_digest(fp, binary, digest, &valid)) {
+        if (*count == capacity) {
+            if (!reserve_memory(MEM_TARGETS, capacity * sizeof(target_entry))) {
+                printf("Warning: Hash list truncated to %d targets by the memory budget\n", *count);
+                break;
+            }
+            capacity *= 2;
+            targets = realloc(targets, capacity * sizeof(target_entry));
+        }
+        target_entry* t = &targets[*count];
+        if (valid) {
+            memcpy(t->digest, digest, MD5_DIGEST_LENGTH);
+            t->cracked = 0;
+            t->settled = 0;
+            t->password[0] = '\0';
+            t->cracked_at = 0;
+            (*count)++;
+        }
+    }
+
+    fclose(fp);
+    release_memory(MEM_TARGETS, (capacity - *count) * sizeof(target_entry));
+    targets = realloc(targets, (*count + 1) * sizeof(target_entry));
+    int duplicates = link_target_aliases(targets, *count);
+    if (duplicates > 0) {
+        printf("Note: %d duplicate digests in %s are searched once\n", duplicates, path);
+    }
+    return targets;
+}
+
+void free_targets(target_entry* targets, int count) {
+    if (targets) {
+        release_memory(MEM_TARGETS, count * sizeof(target_entry));
+        free(targets);
+    }
+}
+
+lookup_strategy pick_lookup_strategy(int live_targets) {
+    if (live_targets <= 1) return LOOKUP_SINGLE;
+    if (live_targets <= ARRAY_LOOKUP_MAX) return LOOKUP_ARRAY;
+    if (live_targets <= TABLE_LOOKUP_MAX) return LOOKUP_TABLE;
+    return LOOKUP_BITMAP_TABLE;
+}
+
+void free_target_lookup(target_lookup* lookup) {
+    free(lookup->first_words);
+    free(lookup->ids);
+    free(lookup->slots);
+    free(lookup->bitmap);
+    release_memory(MEM_LOOKUP, lookup->table_bytes);
+    release_memory(MEM_PREFILTER, lookup->prefilter_bytes);
+    memset(lookup, 0, sizeof(*lookup));
+}
+
+// Slots are indexed by unsigned int, so near INT_MAX targets the table is
+// capped (and runs denser than the plan's load factor) instead of wrapping
+#define MAX_TABLE_SLOTS (1ULL << 31)
+// The prefilter is indexed by one 32-bit digest word; more bits never help
+#define MAX_PREFILTER_BITS (1ULL << 32)
+
+unsigned int table_slot_count(int live, const lookup_plan* plan) {
+    unsigned long long slots = next_power_of_two(live * 100ULL / plan->load_percent);
+    return slots < MAX_TABLE_SLOTS ? slots : MAX_TABLE_SLOTS;
+}
+
+unsigned long long prefilter_bit_count(int live, const lookup_plan* plan) {
+    unsigned long long bits = next_power_of_two((unsigned long long)plan->prefilter_bits * live);
+    return bits < MAX_PREFILTER_BITS ? bits : MAX_PREFILTER_BITS;
+}
+
+// Bytes one lookup over `live` targets needs under `plan`
+unsigned long long lookup_plan_bytes(int live, const lookup_plan* plan) {
+    lookup_strategy strategy = pick_lookup_strategy(live);
+    if (strategy == LOOKUP_SINGLE || strategy == LOOKUP_ARRAY) {
+        return (live + 1ULL) * (sizeof(unsigned int) + sizeof(int));
+    }
+    unsigned long long bytes = (unsigned long long)table_slot_count(live, plan) * sizeof(table_slot);
+    if (strategy == LOOKUP_BITMAP_TABLE && plan->prefilter_bits > 0) {
+        bytes += (prefilter_bit_count(live, plan) / 64 + 1) * sizeof(unsigned long long);
+    }
+    return bytes;
+}
+
+// (Re)build the lookup over the targets that are still uncracked.
+// Returns 0, leaving the lookup empty, if it does not fit the memory budget.
+int build_target_lookup(target_lookup* lookup, const target_entry* targets, int target_count,
+                         const lookup_plan* plan) {
+    int live = 0;
+    for (int i = 0; i < target_count; i++) {
+        live += !targets[i].cracked && !targets[i].settled && !targets[i].duplicate;
+    }
+
+    free_target_lookup(lookup);
+    lookup->tier = pick_lookup_strategy(live);
+    lookup->strategy = lookup->tier;
+    if (lookup->strategy == LOOKUP_BITMAP_TABLE && plan->prefilter_bits == 0) {
+        lookup->strategy = LOOKUP_TABLE;
+    }
+    lookup->count = live;
+
+    if (lookup->strategy == LOOKUP_SINGLE || lookup->strategy == LOOKUP_ARRAY) {
+        lookup->table_bytes = (live + 1ULL) * (sizeof(unsigned int) + sizeof(int));
+        if (!reserve_memory(MEM_LOOKUP, lookup->table_bytes)) {
+            memset(lookup, 0, sizeof(*lookup));
+            return 0;
+        }
+        lookup->first_words = malloc((live + 1) * sizeof(unsigned int));
+        lookup->ids = malloc((live + 1) * sizeof(int));
+        int n = 0;
+        for (int i = 0; i < target_count; i++) {
+            if (!targets[i].cracked && !targets[i].settled && !targets[i].duplicate) {
+                lookup->first_words[n] = digest_word(targets[i].digest, 0);
+                lookup->ids[n++] = i;
+            }
+        }
+        return 1;
+    }
+
+    // Load factor <= 0.5 keeps linear-probe chains short; tight budgets go denser
+    unsigned int slot_count = table_slot_count(live, plan);
+    lookup->table_bytes = (unsigned long long)slot_count * sizeof(table_slot);
+    if (!reserve_memory(MEM_LOOKUP, lookup->table_bytes)) {
+        memset(lookup, 0, sizeof(*lookup));
+        return 0;
+    }
+    lookup->slots = malloc(slot_count * sizeof(table_slot));
+    lookup->slot_mask = slot_count - 1;
+    for (unsigned int s = 0; s < slot_count; s++) {
+        lookup->slots[s].id = -1;
+    }
+
+    // Split big tables into cache-sized slot ranges, probed one at a time
+    unsigned long long table_bytes = (unsigned long long)slot_count * sizeof(table_slot);
+    int slot_bits = __builtin_ctz(slot_count);
+    lookup->partition_count = 1;
+    lookup->partition_shift = slot_bits;
+    if (table_bytes >= PARTITIONED_PROBE_MIN_BYTES) {
+        int partition_bits = __builtin_ctzll(next_power_of_two(table_bytes / PROBE_PARTITION_BYTES));
+        lookup->partition_count = 1 << partition_bits;
+        lookup->partition_shift = slot_bits - partition_bits;
+    }
+
+    if (lookup->strategy == LOOKUP_BITMAP_TABLE) {
+        // ~16 bits per target: most misses are rejected without touching the table
+        unsigned long long bits = prefilter_bit_count(live, plan);
+        lookup->prefilter_bytes = (bits / 64 + 1) * sizeof(unsigned long long);
+        if (!reserve_memory(MEM_PREFILTER, lookup->prefilter_bytes)) {
+            lookup->prefilter_bytes = 0;
+            free_target_lookup(lookup);
+            return 0;
+        }
+        lookup->bitmap = calloc(bits / 64 + 1, sizeof(unsigned long long));
+        lookup->bitmap_mask = bits - 1;
+    }
+
+    for (int i = 0; i < target_count; i++) {
+        if (targets[i].cracked || targets[i].settled || targets[i].duplicate) {
+            continue;
+        }
+        unsigned int key = digest_word(targets[i].digest, 0);
+        unsigned int s = key & lookup->slot_mask;
+        while (lookup->slots[s].id >= 0) {
+            s = (s + 1) & lookup->slot_mask;
+        }
+        lookup->slots[s].key = key;
+        lookup->slots[s].id = i;
+
+        if (lookup->bitmap) {
+            unsigned int bit = digest_word(targets[i].digest, 1) & lookup->bitmap_mask;
+            lookup->bitmap[bit / 64] |= 1ULL << (bit % 64);
+        }
+    }
+    return 1;
+}
+
+int passes_prefilter(const target_lookup* lookup, const unsigned char* digest) {
+    if (!lookup->bitmap) {
+        return 1;
+    }
+    unsigned int bit = digest_word(digest, 1) & lookup->bitmap_mask;
+    return (lookup->bitmap[bit / 64] >> (bit % 64)) & 1;
+}
+
+int probe_table(const target_lookup* lookup, const target_entry* targets,
+                const unsigned char* digest) {
+    unsigned int w0 = digest_word(digest, 0);
+    for (unsigned int s = w0 & lookup->slot_mask; lookup->slots[s].id >= 0;
+         s = (s + 1) & lookup->slot_mask) {
+        if (lookup->slots[s].key == w0 &&
+            memcmp(digest, targets[lookup->slots[s].id].digest, MD5_DIGEST_LENGTH) == 0) {
+            return lookup->slots[s].id;
+        }
+    }
+    return -1;
+}
+
+// Return the id of the target matching `digest`, or -1
+int lookup_target(const target_lookup* lookup, const target_entry* targets,
+                  const unsigned char* digest) {
+    unsigned int w0 = digest_word(digest, 0);
+
+    switch (lookup->strategy) {
+    case LOOKUP_SINGLE:
+        if (lookup->count == 1 && w0 == lookup->first_words[0] &&
+            memcmp(digest, targets[lookup->ids[0]].digest, MD5_DIGEST_LENGTH) == 0) {
+            return lookup->ids[0];
+        }
+        return -1;
+
+    case LOOKUP_ARRAY: {
+        // Branch-free scan so the compiler can broadcast w0 across SIMD lanes.
+        // Targets may share a first word, so every matching lane is checked.
+        for (int base = 0; base < lookup->count; base += 64) {
+            int end = base + 64 < lookup->count ? base + 64 : lookup->count;
+            unsigned long long matches = 0;
+            for (int k = base; k < end; k++) {
+                matches |= (unsigned long long)(lookup->first_words[k] == w0) << (k - base);
+            }
+            while (matches) {
+                int k = base + __builtin_ctzll(matches);
+                if (memcmp(digest, targets[lookup->ids[k]].digest, MD5_DIGEST_LENGTH) == 0) {
+                    return lookup->ids[k];
+                }
+                matches &= matches - 1;
+            }
+        }
+        return -1;
+    }
+
+    case LOOKUP_BITMAP_TABLE:
+        if (!passes_prefilter(lookup, digest)) {
+            return -1;
+        }
+        return probe_table(lookup, targets, digest);
+
+    case LOOKUP_TABLE:
+        return probe_table(lookup, targets, digest);
+    }
+    return -1;
+}
+
+// Build each lookup strategy over targets whose digests come in pairs with
+// the same first word, and look every target up. Returns 1 if all are found.
+int lookup_self_test(void) {
+    static const int sizes[] = { 2, ARRAY_LOOKUP_MAX, 1000, TABLE_LOOKUP_MAX + 2 };
+    int ok = 1;
+
+    // Sizing for target counts near INT_MAX must neither wrap nor hang
+    if (next_power_of_two((1ULL << 31) + 1) != 1ULL << 32 ||
+        table_slot_count(INT_MAX, &LOOKUP_PLANS[LOOKUP_PLAN_COUNT - 1]) < (unsigned int)INT_MAX ||
+        prefilter_bit_count(INT_MAX, &LOOKUP_PLANS[0]) != MAX_PREFILTER_BITS) {
+        printf("Lookup self-test: table sizing overflows near INT_MAX targets\n");
+        ok = 0;
+    }
+    for (int n = 0; n < 4 && ok; n++) {
+        int count = sizes[n];
+        target_entry* targets = calloc(count, sizeof(target_entry));
+        unsigned long long x = 88172645463325252ULL + count;
+        for (int i = 0; i < count; i++) {
+            for (int w = 0; w < MD5_DIGEST_LENGTH; w += 8) {
+                x ^= x << 13; x ^= x >> 7; x ^= x << 17;   // xorshift64
+                memcpy(targets[i].digest + w, &x, 8);
+            }
+            if (i % 2) {
+                memcpy(targets[i].digest, targets[i - 1].digest, 4);
+            }
+            targets[i].next_alias = -1;
+        }
+
+        target_lookup lookup;
+        memset(&lookup, 0, sizeof(lookup));
+        if (!build_target_lookup(&lookup, targets, count, &LOOKUP_PLANS[0])) {
+            ok = -1;
+        }
+        for (int i = 0; i < count && ok == 1; i++) {
+            if (lookup_target(&lookup, targets, targets[i].digest) != i) {
+                printf("Lookup self-test: %s over %d targets misses target %d\n",
+                       LOOKUP_NAMES[lookup.strategy], count, i);
+                ok = 0;
+            }
+        }
+        free_target_lookup(&lookup);
+        free(targets);
+    }
+    return ok;
+}
+
+// Candidates that passed the prefilter, waiting for a partitioned probe
+typedef struct {
+    unsigned char digest[MD5_DIGEST_LENGTH];
+    unsigned long long index;
+} probe_entry;
+
+typedef struct {
+    probe_entry* pending;
+    probe_entry* sorted;
+    int* offsets;
+    int count;
+} probe_batch;
+
+unsigned long long probe_batch_bytes(const target_lookup* lookup) {
+    return 2ULL * PROBE_BATCH_SIZE * sizeof(probe_entry) + (lookup->partition_count + 1) * sizeof(int);
+}
+
+// Returns 0 if the batch does not fit the memory budget
+int init_probe_batch(probe_batch* batch, const target_lookup* lookup) {
+    if (!reserve_memory(MEM_PROBE_BATCH, probe_batch_bytes(lookup))) {
+        return 0;
+    }
+    batch->pending = malloc(PROBE_BATCH_SIZE * sizeof(probe_entry));
+    batch->sorted = malloc(PROBE_BATCH_SIZE * sizeof(probe_entry));
+    batch->offsets = malloc((lookup->partition_count + 1) * sizeof(int));
+    batch->count = 0;
+    return 1;
+}
+
+void free_probe_batch(probe_batch* batch, const target_lookup* lookup) {
+    free(batch->pending);
+    free(batch->sorted);
+    free(batch->offsets);
+    release_memory(MEM_PROBE_BATCH, probe_batch_bytes(lookup));
+}
+
+// Radix-partition the batch by the high bits of each digest's home slot, then
+// probe partition by partition: each pass stays inside one cache-sized range
+// of the table instead of jumping across all of it. Matches are written to
+// `hit_ids` / `hit_indices`; returns the number of matches.
+int probe_partitioned(const target_lookup* lookup, const target_entry* targets,
+                      probe_batch* batch, int* hit_ids, unsigned long long* hit_indices) {
+    int partitions = lookup->partition_count;
+    int* offsets = batch->offsets;
+    int hits = 0;
+
+    memset(offsets, 0, (partitions + 1) * sizeof(int));
+    for (int k = 0; k < batch->count; k++) {
+        unsigned int slot = digest_word(batch->pending[k].digest, 0) & lookup->slot_mask;
+        offsets[(slot >> lookup->partition_shift) + 1]++;
+    }
+    for (int p = 0; p < partitions; p++) {
+        offsets[p + 1] += offsets[p];
+    }
+    for (int k = 0; k < batch->count; k++) {
+        unsigned int slot = digest_word(batch->pending[k].digest, 0) & lookup->slot_mask;
+        batch->sorted[offsets[slot >> lookup->partition_shift]++] = batch->pending[k];
+    }
+
+    for (int k = 0; k < batch->count; k++) {
+        int id = probe_table(lookup, targets, batch->sorted[k].digest);
+        if (id >= 0) {
+            hit_ids[hits] = id;
+            hit_indices[hits++] = batch->sorted[k].index;
+        }
+    }
+
+    batch->count = 0;
+    return hits;
+}
+
+// Compare direct and partitioned table probes on random digests.
+// Returns 1 when partitioned probing was faster on this host.
+int report_probe_throughput(const target_lookup* lookup, const target_entry* targets) {
+    probe_batch batch;
+    if (!init_probe_batch(&batch, lookup)) {
+        return 0;
+    }
+    int* hit_ids = malloc(PROBE_BATCH_SIZE * sizeof(int));
+    unsigned long long* hit_indices = malloc(PROBE_BATCH_SIZE * sizeof(unsigned long long));
+    int rounds = 16;
+    unsigned long long x = 88172645463325252ULL;
+    volatile int sink = 0;
+
+    double direct_time = 0, partitioned_time = 0;
+    for (int r = 0; r < rounds; r++) {
+        for (int k = 0; k < PROBE_BATCH_SIZE; k++) {
+            for (int w = 0; w < MD5_DIGEST_LENGTH; w += 8) {
+                x ^= x << 13; x ^= x >> 7; x ^= x << 17;   // xorshift64
+                memcpy(batch.pending[k].digest + w, &x, 8);
+            }
+            batch.pending[k].index = k;
+        }
+
+        double t0 = omp_get_wtime();
+        for (int k = 0; k < PROBE_BATCH_SIZE; k++) {
+            sink += probe_table(lookup, targets, batch.pending[k].digest);
+        }
+        double t1 = omp_get_wtime();
+        batch.count = PROBE_BATCH_SIZE;
+        sink += probe_partitioned(lookup, targets, &batch, hit_ids, hit_indices);
+        double t2 = omp_get_wtime();
+
+        direct_time += t1 - t0;
+        partitioned_time += t2 - t1;
+    }
+
+    double probes = (double)rounds * PROBE_BATCH_SIZE;
+    printf("Table probe throughput (1 thread): direct %.1f M/s, partitioned %.1f M/s (%d partitions)\n",
+           probes / direct_time / 1e6, probes / partitioned_time / 1e6, lookup->partition_count);
+
+    free(hit_ids);
+    free(hit_indices);
+    free_probe_batch(&batch, lookup);
+    return partitioned_time < direct_time;
+}
+
+// NUMA node of the CPU the calling thread is running on
+int current_numa_node(void) {
+    unsigned int cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0) {
+        return 0;
+    }
+    return node % MAX_NUMA_NODES;
+}
+
+int count_numa_nodes(void) {
+    int nodes = 0;
+    char path[64];
+    for (int n = 0; n < MAX_NUMA_NODES; n++) {
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d", n);
+        if (access(path, F_OK) == 0) {
+            nodes = n + 1;
+        }
+    }
+    return nodes > 0 ? nodes : 1;
+}
+
+// Build one read-only lookup per NUMA node. Each replica is built by a thread
+// running on that node, so first-touch places its pages in node-local memory.
+// Retired targets drop out of every replica because all are rebuilt together.
+// Under a tight memory budget the first plan that fits is used, which may be
+// a single shared replica. A plan whose replicas cannot all be reserved (the
+// budget may shrink between the estimate and the build) falls through to
+// the next one. The team is sized like a search (see ENGINE SELECTION), so a
+// small build runs on the calling thread. Returns the replica count, or 0 if
+// nothing fits.
+int build_lookup_replicas(target_lookup* replicas, int node_count,
+                          const target_entry* targets, int target_count,
+                          const lookup_plan** chosen) {
+    int live = 0;
+    for (int i = 0; i < target_count; i++) {
+        live += !targets[i].cracked && !targets[i].settled && !targets[i].duplicate;
+    }
+    for (int n = 0; n < node_count; n++) {
+        free_target_lookup(&replicas[n]);
+    }
+
+    for (int p = 0; p < LOOKUP_PLAN_COUNT; p++) {
+        const lookup_plan* plan = &LOOKUP_PLANS[p];
+        int replica_count = plan->replicate ? node_count : 1;
+        if (replica_count * lookup_plan_bytes(live, plan) > memory_available()) {
+            continue;
+        }
+        int built[MAX_NUMA_NODES] = { 0 };
+        int failed = 0;
+        int available = omp_get_max_threads();
+        int team = replica_count == 1 ? 1 : fixed_threads ? available :
+                   modelled_threads((double)replica_count * live * LOOKUP_BUILD_COST /
+                                    thread_hash_rate(), available);
+
+        #pragma omp parallel num_threads(team)
+        {
+            int node = current_numa_node() % replica_count;
+            int mine = 0;
+
+            #pragma omp critical
+            {
+                if (!built[node]) {
+                    built[node] = 1;
+                    mine = 1;
+                }
+            }
+            if (mine && !build_target_lookup(&replicas[node], targets, target_count, plan)) {
+                #pragma omp atomic write
+                failed = 1;
+            }
+        }
+
+        // Nodes no thread ran on still get a replica (threads may migrate later)
+        for (int n = 0; n < replica_count && !failed; n++) {
+            if (!built[n] && !build_target_lookup(&replicas[n], targets, target_count, plan)) {
+                failed = 1;
+            }
+        }
+        if (!failed) {
+            *chosen = plan;
+            return replica_count;
+        }
+        for (int n = 0; n < replica_count; n++) {
+            free_target_lookup(&replicas[n]);
+        }
+    }
+    *chosen = NULL;
+    return 0;
+}
+
+void record_target_hit(target_entry* targets, int id, unsigned long long index,
+                       const candidate_mask* mask, int* hits) {
+    #pragma omp critical
+    {
+        if (!targets[id].cracked) {
+            double now = omp_get_wtime();
+            mask_to_password(index, mask, targets[id].password, NULL);
+            publish_hit(targets[id].digest, targets[id].password, index);
+            // Every copy of a duplicated digest is cracked by the same hit
+            for (int a = id; a >= 0; a = targets[a].next_alias) {
+                targets[a].cracked = 1;
+                targets[a].cracked_at = now;
+                strcpy(targets[a].password, targets[id].password);
+                (*hits)++;
+            }
+        }
+    }
+}
+
+// ----------------------------------------------
+// ATTACK LEDGER
+// ----------------------------------------------
+// Ledger lines: "<algorithm> <attack> <fingerprint> <completed> <total>".
+// The side file <ledger path>.<fingerprint> lists each target of the set as
+// "hex" or "hex:password". A target is settled when any entry for the same
+// attack cracked it, or when an exhausted entry (completed == total) had it;
+// a rerun of the exact same target set resumes from `completed`.
+
+const target_entry* sort_targets_base;
+
+int compare_target_ids(const void* a, const void* b) {
+    return memcmp(sort_targets_base[*(const int*)a].digest,
+                  sort_targets_base[*(const int*)b].digest, MD5_DIGEST_LENGTH);
+}
+
+// Target ids ordered by digest, for fingerprinting and ledger lookups
+int* sort_target_ids(const target_entry* targets, int count) {
+    int* ids = malloc((count + 1) * sizeof(int));
+    for (int i = 0; i < count; i++) {
+        ids[i] = i;
+    }
+    sort_targets_base = targets;
+    qsort(ids, count, sizeof(int), compare_target_ids);
+    return ids;
+}
+
+// FNV-1a over the sorted digests: the same set gives the same fingerprint
+// whatever order the hash file lists it in
+unsigned long long fingerprint_targets(const target_entry* targets, const int* sorted, int count) {
+    unsigned long long h = 14695981039346656037ULL;
+    for (int i = 0; i < count; i++) {
+        if (i > 0 && memcmp(targets[sorted[i]].digest, targets[sorted[i - 1]].digest,
+                            MD5_DIGEST_LENGTH) == 0) {
+            continue;
+        }
+        for (int b = 0; b < MD5_DIGEST_LENGTH; b++) {
+            h = (h ^ targets[sorted[i]].digest[b]) * 1099511628211ULL;
+        }
+    }
+    return h;
+}
+
+// Position in `sorted` of the first target with this digest, or -1
+int find_target_rank(const target_entry* targets, const int* sorted, int count,
+                     const unsigned char* digest) {
+    int lo = 0, hi = count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (memcmp(targets[sorted[mid]].digest, digest, MD5_DIGEST_LENGTH) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo < count && memcmp(targets[sorted[lo]].digest, digest, MD5_DIGEST_LENGTH) == 0) {
+        return lo;
+    }
+    return -1;
+}
+
+// Apply one entry's side file. Cracked targets are always taken over;
+// uncracked ones are settled only when the entry covered the whole keyspace.
+void apply_ledger_targets(unsigned long long fingerprint, int exhausted,
+                          target_entry* targets, const int* sorted, int count) {
+    char path[256];
+    char line[128];
+    snprintf(path, sizeof(path), "%s.%016llx", ledger_path, fingerprint);
+    FILE* fp = fopen(path, "r");
+    if (!fp) {
+        return;
+    }
+
+    while (fgets(line, sizeof(line), fp)) {
+        unsigned char digest[MD5_DIGEST_LENGTH];
+        if (strlen(line) < MD5_DIGEST_LENGTH * 2 || !parse_hex_digest(line, digest)) {
+            continue;
+        }
+        int first = find_target_rank(targets, sorted, count, digest);
+        if (first < 0) {
+            continue;
+        }
+        char* password = line + MD5_DIGEST_LENGTH * 2;
+        password[strcspn(password, "\r\n")] = '\0';
+
+        // Duplicate digests in the hash file all share the outcome
+        for (int i = first; i < count &&
+             memcmp(targets[sorted[i]].digest, digest, MD5_DIGEST_LENGTH) == 0; i++) {
+            target_entry* t = &targets[sorted[i]];
+            if (t->cracked) {
+                continue;
+            }
+            if (*password == ':') {
+                t->cracked = 1;
+                t->settled = 1;
+                strncpy(t->password, password + 1, MAX_PASSWORD_LENGTH);
+                t->password[MAX_PASSWORD_LENGTH] = '\0';
+            } else if (exhausted) {
+                t->settled = 1;
+            }
+        }
+    }
+    fclose(fp);
+}
+
+// The ledger's attack field for a mask. Fields are whitespace-separated,
+// so whitespace (e.g. the space in ?s) and '%' are written as %XX.
+void mask_ledger_key(const candidate_mask* mask, char* key, size_t size) {
+    size_t n = snprintf(key, size, "mask:");
+    for (const char* c = mask->text; *c && n + 4 <= size; c++) {
+        if (isspace((unsigned char)*c) || *c == '%') {
+            n += snprintf(key + n, size - n, "%%%02X", (unsigned char)*c);
+        } else {
+            key[n++] = *c;
+            key[n] = '\0';
+        }
+    }
+}
+
+// Settle targets from earlier entries for this attack. Returns the keyspace
+// prefix already searched for exactly this target set (0 if none).
+unsigned long long read_ledger(const char* algorithm, const char* attack,
+                               unsigned long long fingerprint, target_entry* targets,
+                               const int* sorted, int count) {
+    FILE* fp = fopen(ledger_path, "r");
+    if (!fp) {
+        return 0;
+    }
+
+    char line[512];
+    unsigned long long resume = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        char entry_algorithm[64], entry_attack[256];
+        unsigned long long entry_fingerprint, completed, total;
+        if (sscanf(line, "%63s %255s %llx %llu %llu", entry_algorithm, entry_attack,
+                   &entry_fingerprint, &completed, &total) != 5 ||
+            strcmp(entry_algorithm, algorithm) != 0 || strcmp(entry_attack, attack) != 0) {
+            continue;
+        }
+        apply_ledger_targets(entry_fingerprint, completed >= total, targets, sorted, count);
+        if (entry_fingerprint == fingerprint) {
+            resume = completed;
+        }
+    }
+    fclose(fp);
+    return resume;
+}
+
+// Record progress for this target set: rewrite its side file, then replace
+// its ledger line. Both are written to a temporary file and renamed into place.
+void write_ledger(const char* algorithm, const char* attack, unsigned long long fingerprint,
+                  unsigned long long completed, unsigned long long total,
+                  const target_entry* targets, int count) {
+    char path[256], tmp[272];
+    char hex[MD5_DIGEST_LENGTH * 2 + 1];
+
+    snprintf(path, sizeof(path), "%s.%016llx", ledger_path, fingerprint);
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE* out = fopen(tmp, "w");
+    if (!out) {
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        hash_to_hex((unsigned char*)targets[i].digest, hex);
+        if (targets[i].cracked) {
+            fprintf(out, "%s:%s\n", hex, targets[i].password);
+        } else {
+            fprintf(out, "%s\n", hex);
+        }
+    }
+    fclose(out);
+    rename(tmp, path);
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", ledger_path);
+    out = fopen(tmp, "w");
+    if (!out) {
+        return;
+    }
+    FILE* in = fopen(ledger_path, "r");
+    char line[512];
+    while (in && fgets(line, sizeof(line), in)) {
+        char entry_algorithm[64], entry_attack[256];
+        unsigned long long entry_fingerprint;
+        if (sscanf(line, "%63s %255s %llx", entry_algorithm, entry_attack,
+                   &entry_fingerprint) == 3 &&
+            strcmp(entry_algorithm, algorithm) == 0 && strcmp(entry_attack, attack) == 0 &&
+            entry_fingerprint == fingerprint) {
+            continue;
+        }
+        fputs(line, out);
+    }
+    if (in) {
+        fclose(in);
+    }
+    fprintf(out, "%s %s %016llx %llu %llu\n", algorithm, attack, fingerprint, completed, total);
+    fclose(out);
+    rename(tmp, ledger_path);
+}
+
+// List the targets an earlier run settled, so a skipped target is not
+// mistaken for one this run missed
+void print_settled_targets(const target_entry* targets, int count) {
+    int listed = 0, settled = 0;
+    char hex[MD5_DIGEST_LENGTH * 2 + 1];
+
+    for (int i = 0; i < count; i++) {
+        if (!targets[i].settled) {
+            continue;
+        }
+        if (listed < LEDGER_LIST_MAX) {
+            hash_to_hex((unsigned char*)targets[i].digest, hex);
+            if (targets[i].cracked) {
+                printf("  %s:%s (cracked earlier)\n", hex, targets[i].password);
+            } else {
+                printf("  %s (not in the keyspace)\n", hex);
+            }
+            listed++;
+        }
+        settled++;
+    }
+    if (settled > listed) {
+        printf("  ... and %d more\n", settled - listed);
+    }
+}
+
+// Timing of the last multi-target pass, for --pipeline compare
+typedef struct {
+    const char* placement;              // As run: smt may fall back to unpinned
+    int threads;
+    double elapsed;
+    unsigned long long attempts;
+    double full_waits, empty_waits;     // Per 1000 blocks; pipelined passes only
+} pass_timing;
+
+pass_timing last_pass;
+
+// Search the keyspace for every target; outcomes are left in `targets`.
+// `source` only labels the run in the report.
+int crack_targets(target_entry* targets, int target_count, const char* source,
+                  const candidate_mask* mask) {
+    unsigned long long total_combinations = mask_keyspace(mask);
+    unsigned long long attempts = 0;
+
+    // Skip keyspace and targets whose outcome an earlier run already recorded
+    char attack[3 * MAX_MASK_TEXT + 8];
+    mask_ledger_key(mask, attack, sizeof(attack));
+    unsigned long long fingerprint = 0, resume = 0;
+    if (ledger_path) {
+        int* sorted = sort_target_ids(targets, target_count);
+        fingerprint = fingerprint_targets(targets, sorted, target_count);
+        resume = read_ledger("md5", attack, fingerprint, targets, sorted, target_count);
+        free(sorted);
+    }
+
+    int live = 0;
+    for (int i = 0; i < target_count; i++) {
+        live += !targets[i].cracked && !targets[i].settled;
+    }
+
+    // Workers probe the replica on their own NUMA node
+    int node_count = count_numa_nodes();
+    target_lookup replicas[MAX_NUMA_NODES];
+    memset(replicas, 0, sizeof(replicas));
+    const lookup_plan* plan;
+    int replica_count = build_lookup_replicas(replicas, node_count, targets, target_count, &plan);
+    if (replica_count == 0) {
+        printf("Error: %d target lookups need %.1f MB, over the %.1f MB left in the memory budget\n",
+               live, lookup_plan_bytes(live, &LOOKUP_PLANS[LOOKUP_PLAN_COUNT - 1]) / 1048576.0,
+               memory_available() / 1048576.0);
+        return 0;
+    }
+
+    printf("\n=== Starting Multi-Target Search (OpenMP) ===\n");
+    printf("Targets: %d (from %s)\n", target_count, source);
+    printf("Lookup strategy: %s\n", LOOKUP_NAMES[replicas[0].strategy]);
+    printf("NUMA nodes: %d (%d lookup replica%s)\n", node_count, replica_count,
+           replica_count == 1 ? "" : "s");
+    if (plan != &LOOKUP_PLANS[0]) {
+        printf("Memory budget: lookup degraded to \"%s\" (%d-bit prefilter, %d%% load)\n",
+               plan->name, plan->prefilter_bits, plan->load_percent);
+    }
+    printf("Mask: %s (length %d)\n", mask->text, mask->length);
+    int threads = choose_threads(live > 0 ? total_combinations - resume : 0,
+                                 target_lookup_cost(live));
+    printf("Threads: %d\n", threads);
+    printf("Total combinations: %llu\n", total_combinations);
+    if (ledger_path) {
+        printf("Ledger: %s (target set %016llx), %d targets already settled\n",
+               ledger_path, fingerprint, target_count - live);
+        print_settled_targets(targets, target_count);
+        if (live == 0) {
+            printf("Every target is covered by an earlier attack; skipping the keyspace\n");
+        } else if (resume > 0) {
+            printf("Resuming at candidate %llu of %llu\n", resume, total_combinations);
+        }
+    }
+    int use_partitioned = 0;
+    if (replicas[0].partition_count > 1) {
+        use_partitioned = report_probe_throughput(&replicas[0], targets);
+        printf("Probe mode: %s\n", use_partitioned ? "partitioned batches" : "direct");
+    }
+    printf("Tail mitigation: %s\n", speculative_tail ? "split oldest chunk" : "off");
+    printf("\n");
+
+    tail_chunk* chunks = calloc(threads, sizeof(tail_chunk));
+    for (int t = 0; t < threads; t++) {
+        omp_init_lock(&chunks[t].lock);
+    }
+    double tail_time = 0;
+    unsigned long long splits = 0;
+    stage_clock* clocks = calloc(threads, sizeof(stage_clock));
+
+    double start_time = omp_get_wtime();
+    double saved_at = start_time;
+    unsigned long long base = resume;
+
+    ring_progress progress = { ++ring_pass, target_count, target_count - live, "", resume,
+                               total_combinations, 0, 0 };
+    snprintf(progress.attack, sizeof(progress.attack), "%s", mask->text);
+    publish_progress(&progress);
+
+    // The keyspace is walked in rounds; cracked targets are retired between
+    // rounds, and the lookup is re-picked when the live count changes tier.
+    for (; base < total_combinations && live > 0; base += MULTI_TARGET_CHUNK) {
+        unsigned long long end = base + MULTI_TARGET_CHUNK;
+        if (end > total_combinations) {
+            end = total_combinations;
+        }
+        int hits = 0;
+        int partitioned = use_partitioned && replicas[0].strategy == LOOKUP_BITMAP_TABLE &&
+                          replicas[0].partition_count > 1;
+        unsigned long long cursor = base;
+        double tail_start = 0;
+
+        #pragma omp parallel num_threads(threads) reduction(+:attempts)
+        {
+            const target_lookup* lookup = &replicas[current_numa_node() % replica_count];
+            char guess[MAX_PASSWORD_LENGTH + 1];
+            unsigned char guess_hash[MD5_DIGEST_LENGTH];
+            probe_batch batch;
+            int* hit_ids = NULL;
+            unsigned long long* hit_indices = NULL;
+
+            // Threads whose batch does not fit the budget probe directly
+            int batched = partitioned && init_probe_batch(&batch, lookup);
+            if (batched) {
+                hit_ids = malloc(PROBE_BATCH_SIZE * sizeof(int));
+                hit_indices = malloc(PROBE_BATCH_SIZE * sizeof(unsigned long long));
+            }
+
+            int self = omp_get_thread_num();
+            unsigned long long from, to;
+            stage_clock* clock = &clocks[self];
+
+            while (claim_tail_chunk(chunks, threads, self, &cursor, end, &tail_start, &splits)) {
+                for (;;) {
+                    int timed = stage_sample > 0 && ++clock->steps % stage_sample == 0;
+                    if (timed) {
+                        clock->last = read_cycles();
+                    }
+                    if (!next_tail_step(&chunks[self], &from, &to)) {
+                        break;
+                    }
+                    if (timed) {
+                        stage_mark(clock, STAGE_BOOKKEEPING);
+                        clock->candidates += to - from;
+                        clock->batches++;
+                    }
+                    int digits[MAX_PASSWORD_LENGTH];
+                    mask_to_password(from, mask, guess, digits);
+
+                    for (unsigned long long i = from; i < to; i++) {
+                        if (i > from) {
+                            next_mask_candidate(mask, digits, guess);
+                        }
+                        if (timed) {
+                            stage_mark(clock, STAGE_GENERATE);
+                        }
+                        generate_hash(guess, guess_hash);
+                        attempts++;
+                        if (timed) {
+                            stage_mark(clock, STAGE_HASH);
+                        }
+
+                        if (batched) {
+                            // Defer the table probe until a full batch has passed the prefilter
+                            if (passes_prefilter(lookup, guess_hash)) {
+                                memcpy(batch.pending[batch.count].digest, guess_hash, MD5_DIGEST_LENGTH);
+                                batch.pending[batch.count++].index = i;
+                                if (batch.count == PROBE_BATCH_SIZE) {
+                                    int n = probe_partitioned(lookup, targets, &batch, hit_ids, hit_indices);
+                                    for (int h = 0; h < n; h++) {
+                                        record_target_hit(targets, hit_ids[h], hit_indices[h],
+                                                          mask, &hits);
+                                    }
+                                }
+                            }
+                        } else {
+                            int id = lookup_target(lookup, targets, guess_hash);
+                            if (id >= 0) {
+                                record_target_hit(targets, id, i, mask, &hits);
+                            }
+                        }
+                        if (timed) {
+                            stage_mark(clock, STAGE_LOOKUP);
+                        }
+                    }
+                }
+            }
+
+            if (batched) {
+                int n = probe_partitioned(lookup, targets, &batch, hit_ids, hit_indices);
+                for (int h = 0; h < n; h++) {
+                    record_target_hit(targets, hit_ids[h], hit_indices[h], mask, &hits);
+                }
+                free(hit_ids);
+                free(hit_indices);
+                free_probe_batch(&batch, lookup);
+            }
+        }
+
+        tail_time += omp_get_wtime() - tail_start;
+
+        if (hits > 0) {
+            live -= hits;
+            lookup_strategy previous = replicas[0].strategy;
+            // Small structures are compacted every time; big ones only when
+            // the live count drops into a cheaper tier. Fewer targets always
+            // fit in the memory the current plan already holds.
+            if (previous <= LOOKUP_ARRAY || pick_lookup_strategy(live) != replicas[0].tier) {
+                replica_count = build_lookup_replicas(replicas, node_count, targets, target_count, &plan);
+                if (replica_count == 0) {
+                    printf("Error: The target lookup no longer fits the memory budget; stopping\n");
+                    break;
+                }
+                if (replicas[0].strategy != previous) {
+                    printf("Lookup strategy: %s (%d targets left)\n",
+                           LOOKUP_NAMES[replicas[0].strategy], live);
+                }
+            }
+        }
+
+        if (ledger_path && omp_get_wtime() - saved_at >= LEDGER_SAVE_SECONDS) {
+            write_ledger("md5", attack, fingerprint, end, total_combinations,
+                         targets, target_count);
+            saved_at = omp_get_wtime();
+        }
+
+        progress.cracked = target_count - live;
+        progress.completed = end;
+        progress.attempts = attempts;
+        progress.elapsed = omp_get_wtime() - start_time;
+        publish_progress(&progress);
+    }
+
+    double elapsed = omp_get_wtime() - start_time;
+    if (ledger_path && base > resume) {
+        write_ledger("md5", attack, fingerprint,
+                     base < total_combinations ? base : total_combinations,
+                     total_combinations, targets, target_count);
+    }
+
+    int cracked = 0;
+
+    for (int i = 0; i < target_count; i++) {
+        if (targets[i].cracked) {
+            char hex[MD5_DIGEST_LENGTH * 2 + 1];
+            hash_to_hex(targets[i].digest, hex);
+            printf("%s:%s\n", hex, targets[i].password);
+            cracked++;
+        }
+    }
+
+    printf("\nCracked: %d / %d targets\n", cracked, target_count);
+    printf("Total attempts: %llu\n", attempts);
+    printf("Execution time: %.3f seconds\n", elapsed);
+    printf("Passwords per second: %.0f\n", attempts / elapsed);
+    printf("Tail time: %.3f seconds (%llu chunk splits)\n", tail_time, splits);
+    last_pass = (pass_timing){ "every thread", threads, elapsed, attempts, 0, 0 };
+    if (stage_sample > 0) {
+        print_stage_timing(clocks, threads);
+    }
+    print_memory_report();
+
+    for (int t = 0; t < threads; t++) {
+        omp_destroy_lock(&chunks[t].lock);
+    }
+    free(chunks);
+    free(clocks);
+    for (int n = 0; n < node_count; n++) {
+        free_target_lookup(&replicas[n]);
+    }
+    return cracked;
+}
+
+// ----------------------------------------------
+// PIPELINED MULTI-TARGET SEARCH
+// ----------------------------------------------
+// --pipeline smt|cross splits the multi-target search into pairs of threads:
+// a generator that walks the mask into blocks of candidates, and a hasher
+// that hashes and probes them. Each pair passes blocks through its own ring
+// of PIPE_SLOTS blocks (about 22 KB), on pages of its own so the hasher's
+// first touch places it on that core's NUMA node. Generation is branchy scalar code and
+// MD5 keeps the integer units busy, so the two stages can share a physical
+// core. "smt" pins a pair on the two SMT siblings of one core, so the ring
+// stays in that core's L1/L2. "cross" pins the same CPUs, but pairs each
+// hasher with the generator on the next core, so every block crosses cores.
+// The pass is a single sweep: no ledger, tail splitting or target retirement.
+// --pipeline compare runs the default search, smt and cross on the same
+// targets with the same threads and prints them side by side.
+
+#define PIPE_BLOCK 256
+#define PIPE_SLOTS 8
+#define PIPE_RING_ALIGN 4096        // Rings never share a page
+#define MAX_PIPE_PAIRS 256
+
+typedef enum { PLACEMENT_UNPINNED, PLACEMENT_SMT, PLACEMENT_CROSS } pipeline_placement;
+
+static const char* PLACEMENT_NAMES[] = { "unpinned", "smt", "cross" };
+
+int use_pipeline = 0;               // Set by --pipeline
+int compare_placements = 0;         // Set by --pipeline compare
+pipeline_placement placement = PLACEMENT_SMT;
+
+typedef struct {
+    unsigned long long first;       // Candidate index of candidates[0]
+    int count;
+    char candidates[PIPE_BLOCK][MAX_PASSWORD_LENGTH + 1];
+} candidate_block;
+
+// The generator writes the first cache line, the hasher the second
+typedef struct {
+    unsigned long long head __attribute__((aligned(64)));  // Blocks produced
+    unsigned long long full_waits;
+    int done;
+    unsigned long long tail __attribute__((aligned(64)));  // Blocks consumed
+    unsigned long long empty_waits;
+    candidate_block slots[PIPE_SLOTS] __attribute__((aligned(64)));
+} pipeline_pair;
+
+// Pairs of SMT siblings among the CPUs this process may run on, one per
+// physical core. Returns the number of cores found.
+int find_smt_cores(int cores[][2], int max_cores) {
+    cpu_set_t allowed, used;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return 0;
+    }
+    CPU_ZERO(&used);
+
+    int count = 0;
+    for (int cpu = 0; cpu < CPU_SETSIZE && count < max_cores; cpu++) {
+        if (!CPU_ISSET(cpu, &allowed) || CPU_ISSET(cpu, &used)) {
+            continue;
+        }
+        // "0,64" or "0-1"; a core without SMT lists only itself
+        char path[96];
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+        FILE* fp = fopen(path, "r");
+        int first, second;
+        char separator;
+        if (!fp) {
+            continue;
+        }
+        int listed = fscanf(fp, "%d%c%d", &first, &separator, &second);
+        fclose(fp);
+        int sibling = first == cpu ? second : first;
+        if (listed != 3 || sibling == cpu || sibling >= CPU_SETSIZE ||
+            !CPU_ISSET(sibling, &allowed) || CPU_ISSET(sibling, &used)) {
+            continue;
+        }
+        CPU_SET(cpu, &used);
+        CPU_SET(sibling, &used);
+        cores[count][0] = cpu;
+        cores[count][1] = sibling;
+        count++;
+    }
+    return count;
+}
+
+void pin_thread(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+// Spin briefly for the other stage, then give up the CPU in case both
+// stages share one (unpinned or oversubscribed runs)
+static inline void pipe_wait(int* spins) {
+    if (++*spins < 64) {
+#if defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#endif
+    } else {
+        sched_yield();
+    }
+}
+
+void generate_blocks(pipeline_pair* pair, const candidate_mask* mask, unsigned long long from,
+                     unsigned long long to, volatile int* stop) {
+    char guess[MAX_PASSWORD_LENGTH + 1];
+    int digits[MAX_PASSWORD_LENGTH];
+    if (from < to) {
+        mask_to_password(from, mask, guess, digits);
+    }
+
+    unsigned long long i = from;
+    while (i < to && !*stop) {
+        unsigned long long head = pair->head;
+        int spins = 0;
+        if (head - __atomic_load_n(&pair->tail, __ATOMIC_ACQUIRE) == PIPE_SLOTS) {
+            pair->full_waits++;
+            while (head - __atomic_load_n(&pair->tail, __ATOMIC_ACQUIRE) == PIPE_SLOTS && !*stop) {
+                pipe_wait(&spins);
+            }
+            continue;
+        }
+
+        candidate_block* block = &pair->slots[head % PIPE_SLOTS];
+        block->first = i;
+        block->count = 0;
+        for (; i < to && block->count < PIPE_BLOCK; i++) {
+            memcpy(block->candidates[block->count++], guess, mask->length + 1);
+            next_mask_candidate(mask, digits, guess);
+        }
+        __atomic_store_n(&pair->head, head + 1, __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&pair->done, 1, __ATOMIC_RELEASE);
+}
+
+void hash_blocks(pipeline_pair* pair, const target_lookup* lookup, target_entry* targets,
+                 const candidate_mask* mask, int live, int* hits, volatile int* stop,
+                 unsigned long long* attempts) {
+    unsigned char guess_hash[MD5_DIGEST_LENGTH];
+    for (;;) {
+        unsigned long long tail = pair->tail;
+        if (tail == __atomic_load_n(&pair->head, __ATOMIC_ACQUIRE)) {
+            // `done` is stored after the last head, so recheck head after it
+            if (__atomic_load_n(&pair->done, __ATOMIC_ACQUIRE) &&
+                tail == __atomic_load_n(&pair->head, __ATOMIC_ACQUIRE)) {
+                return;
+            }
+            int spins = 0;
+            pair->empty_waits++;
+            while (tail == __atomic_load_n(&pair->head, __ATOMIC_ACQUIRE) &&
+                   !__atomic_load_n(&pair->done, __ATOMIC_ACQUIRE)) {
+                pipe_wait(&spins);
+            }
+            continue;
+        }
+
+        const candidate_block* block = &pair->slots[tail % PIPE_SLOTS];
+        for (int c = 0; c < block->count; c++) {
+            MD5((const unsigned char*)block->candidates[c], mask->length, guess_hash);
+            int id = lookup_target(lookup, targets, guess_hash);
+            if (id >= 0) {
+                record_target_hit(targets, id, block->first + c, mask, hits);
+            }
+        }
+        *attempts += block->count;
+        __atomic_store_n(&pair->tail, tail + 1, __ATOMIC_RELEASE);
+
+        if (__atomic_load_n(hits, __ATOMIC_RELAXED) >= live) {
+            *stop = 1;
+        }
+    }
+}
+
+int crack_targets_pipelined(target_entry* targets, int target_count, const char* source,
+                            const candidate_mask* mask) {
+    unsigned long long total_combinations = mask_keyspace(mask);
+    int live = 0;
+    for (int i = 0; i < target_count; i++) {
+        live += !targets[i].cracked && !targets[i].settled;
+    }
+
+    // One pair per core, within the thread limit
+    static int cores[MAX_PIPE_PAIRS][2];
+    int core_count = find_smt_cores(cores, MAX_PIPE_PAIRS);
+    int pairs = omp_get_max_threads() / 2;
+    if (pairs < 1) {
+        pairs = 1;
+    }
+    pipeline_placement used = placement;
+    if (core_count == 0) {
+        printf("Pipeline: no SMT siblings among this process's CPUs; running unpinned\n");
+        used = PLACEMENT_UNPINNED;
+    } else if (pairs > core_count) {
+        pairs = core_count;
+    }
+    if (pairs > MAX_PIPE_PAIRS) {
+        pairs = MAX_PIPE_PAIRS;
+    }
+    if (used == PLACEMENT_CROSS && pairs == 1) {
+        printf("Pipeline: cross placement needs two cores; one pair is placed as smt\n");
+        used = PLACEMENT_SMT;
+    }
+
+    int node_count = count_numa_nodes();
+    target_lookup replicas[MAX_NUMA_NODES];
+    memset(replicas, 0, sizeof(replicas));
+    const lookup_plan* plan;
+    int replica_count = build_lookup_replicas(replicas, node_count, targets, target_count, &plan);
+    size_t ring_stride = (sizeof(pipeline_pair) + PIPE_RING_ALIGN - 1) & ~(size_t)(PIPE_RING_ALIGN - 1);
+    unsigned long long ring_bytes = pairs * ring_stride;
+    if (replica_count == 0 || !reserve_memory(MEM_PIPELINE, ring_bytes)) {
+        printf("Error: The pipelined search does not fit the %.1f MB left in the memory budget\n",
+               memory_available() / 1048576.0);
+        for (int n = 0; n < node_count; n++) {
+            free_target_lookup(&replicas[n]);
+        }
+        return 0;
+    }
+    char* rings = aligned_alloc(PIPE_RING_ALIGN, ring_bytes);
+
+    printf("\n=== Starting Pipelined Multi-Target Search (OpenMP) ===\n");
+    printf("Targets: %d (from %s)\n", target_count, source);
+    printf("Lookup strategy: %s\n", LOOKUP_NAMES[replicas[0].strategy]);
+    printf("Mask: %s (length %d)\n", mask->text, mask->length);
+    printf("Pairs: %d generator + hasher (%d threads), placement %s\n", pairs, 2 * pairs,
+           PLACEMENT_NAMES[used]);
+    static int pair_cpus[MAX_PIPE_PAIRS][2];   // Hasher, generator
+    for (int p = 0; p < pairs && used != PLACEMENT_UNPINNED; p++) {
+        pair_cpus[p][0] = cores[p][0];
+        pair_cpus[p][1] = used == PLACEMENT_SMT ? cores[p][1] : cores[(p + 1) % pairs][1];
+        printf("  pair %d: hasher on CPU %d, generator on CPU %d\n", p, pair_cpus[p][0],
+               pair_cpus[p][1]);
+    }
+    printf("Total combinations: %llu\n\n", total_combinations);
+
+    volatile int stop = live == 0;
+    int hits = 0;
+    unsigned long long attempts = 0;
+    unsigned long long share = total_combinations / pairs;
+    double start_time = omp_get_wtime();
+
+    #pragma omp parallel num_threads(2 * pairs) reduction(+:attempts)
+    {
+        int self = omp_get_thread_num();
+        int p = self / 2;
+        pipeline_pair* pair = (pipeline_pair*)(rings + p * ring_stride);
+        if (used != PLACEMENT_UNPINNED) {
+            pin_thread(pair_cpus[p][self % 2]);
+        }
+        // First touch from the pinned hasher puts its ring in that core's node
+        if (self % 2 == 0) {
+            memset(pair, 0, sizeof(*pair));
+        }
+        #pragma omp barrier
+        unsigned long long from = p * share;
+        unsigned long long to = p == pairs - 1 ? total_combinations : from + share;
+
+        if (self % 2) {
+            generate_blocks(pair, mask, from, to, &stop);
+        } else {
+            const target_lookup* lookup = &replicas[current_numa_node() % replica_count];
+            hash_blocks(pair, lookup, targets, mask, live, &hits, &stop, &attempts);
+        }
+    }
+
+    double elapsed = omp_get_wtime() - start_time;
+
+    int cracked = 0;
+    for (int i = 0; i < target_count; i++) {
+        if (targets[i].cracked) {
+            char hex[MD5_DIGEST_LENGTH * 2 + 1];
+            hash_to_hex(targets[i].digest, hex);
+            printf("%s:%s\n", hex, targets[i].password);
+            cracked++;
+        }
+    }
+
+    unsigned long long full_waits = 0, empty_waits = 0;
+    for (int p = 0; p < pairs; p++) {
+        const pipeline_pair* pair = (const pipeline_pair*)(rings + p * ring_stride);
+        full_waits += pair->full_waits;
+        empty_waits += pair->empty_waits;
+    }
+    unsigned long long blocks = (attempts + PIPE_BLOCK - 1) / PIPE_BLOCK;
+
+    printf("\nCracked: %d / %d targets\n", cracked, target_count);
+    printf("Total attempts: %llu\n", attempts);
+    printf("Execution time: %.3f seconds\n", elapsed);
+    printf("Passwords per second: %.0f\n", attempts / elapsed);
+    last_pass = (pass_timing){ PLACEMENT_NAMES[used], 2 * pairs, elapsed, attempts,
+                               blocks ? 1000.0 * full_waits / blocks : 0,
+                               blocks ? 1000.0 * empty_waits / blocks : 0 };
+    printf("Pipeline waits per 1000 blocks: generator %.1f (ring full), hasher %.1f (ring empty)\n",
+           last_pass.full_waits, last_pass.empty_waits);
+    print_memory_report();
+
+    free(rings);
+    release_memory(MEM_PIPELINE, ring_bytes);
+    for (int n = 0; n < node_count; n++) {
+        free_target_lookup(&replicas[n]);
+    }
+    return cracked;
+}
+
+// --pipeline compare: each placement starts from a freshly loaded target list
+// and the ledger is off, so every run does the same work. The default search
+// gets the pipelines' thread count, not a modelled one.
+int compare_pipeline_placements(const char* target_path, const candidate_mask* mask) {
+    static const char* names[] = { "default", "smt", "cross" };
+    pass_timing runs[3];
+    int cracked[3];
+    int saved_fixed = fixed_threads, saved_threads = omp_get_max_threads();
+    ledger_path = NULL;
+
+    for (int k = 0; k < 3; k++) {
+        int run = (k + 1) % 3;      // smt first, to learn the thread count
+        int target_count = 0;
+        target_entry* targets = load_targets(target_path, &target_count);
+        if (!targets || target_count == 0) {
+            printf("Error: No MD5 digests loaded from %s\n", target_path);
+            free_targets(targets, target_count);
+            return 0;
+        }
+        last_pass = (pass_timing){ "failed", 0, 0, 0, 0, 0 };
+        if (run == 0) {
+            fixed_threads = 1;
+            omp_set_num_threads(runs[1].threads > 0 ? runs[1].threads : saved_threads);
+            cracked[run] = crack_targets(targets, target_count, target_path, mask);
+            fixed_threads = saved_fixed;
+            omp_set_num_threads(saved_threads);
+        } else {
+            placement = run == 1 ? PLACEMENT_SMT : PLACEMENT_CROSS;
+            cracked[run] = crack_targets_pipelined(targets, target_count, target_path, mask);
+        }
+        runs[run] = last_pass;
+        free_targets(targets, target_count);
+    }
+
+    printf("\n=== Placement Comparison ===\n");
+    printf("%-8s %-13s %7s %9s %11s %9s %10s %8s\n", "Run", "Placed as", "Threads",
+           "Time (s)", "Rate (M/s)", "Gen waits", "Hash waits", "Cracked");
+    for (int run = 0; run < 3; run++) {
+        double rate = runs[run].elapsed > 0 ? runs[run].attempts / runs[run].elapsed / 1e6 : 0;
+        printf("%-8s %-13s %7d %9.3f %11.2f ", names[run], runs[run].placement,
+               runs[run].threads, runs[run].elapsed, rate);
+        if (run == 0) {
+            printf("%9s %10s %8d\n", "-", "-", cracked[run]);
+        } else {
+            printf("%9.1f %10.1f %8d\n", runs[run].full_waits, runs[run].empty_waits, cracked[run]);
+        }
+    }
+    printf("Waits are per 1000 blocks. smt vs cross: %.2fx\n",
+           runs[2].elapsed > 0 && runs[1].elapsed > 0 ? runs[2].elapsed / runs[1].elapsed : 0);
+    return cracked[1];
+}
+
+int crack_target_list(const char* target_path, const candidate_mask* mask) {
+    if (compare_placements) {
+        return compare_pipeline_placements(target_path, mask);
+    }
+
+    int target_count = 0;
+    target_entry* targets = load_targets(target_path, &target_count);
+    if (!targets || target_count == 0) {
+        printf("Error: No MD5 digests loaded from %s\n", target_path);
+        free_targets(targets, target_count);
+        return 0;
+    }
+
+    int cracked = use_pipeline ? crack_targets_pipelined(targets, target_count, target_path, mask)
+                               : crack_targets(targets, target_count, target_path, mask);
+    free_targets(targets, target_count);
+    return cracked;
+}
+
+// ----------------------------------------------
+// BATCH MODE (JOB COALESCING)
+// ----------------------------------------------
+// A job file lists one job per line: "<name> <hash_file> <attack> [class]
+// [priority]", where the attack is a length, a mask, or @file for every mask
+// in a mask file (one per line, e.g. from tools/mask_generator.c; run in file
+// order). Passes run highest priority first, then in file order, the same
+// policy a trace replay uses; class only matters to traces (see JOB TRACE
+// REPLAY). Jobs running the same attack are merged: their digests are pooled
+// into one de-duplicated target set, the keyspace is searched once, and each
+// job gets back the hits for its own digests in <name>.cracked ("hash:password").
+
+#define MAX_JOBS 4096
+#define MAX_JOB_NAME 64
+
+const char* trace_path = NULL;      // Set by --trace: record submissions here
+
+// Trace line: "<unix_time> <name> <class> <priority> md5 <hash_file> <attack> <targets>".
+// The time is when the job line is read, so every job of one batch file
+// arrives within milliseconds; spread-out arrivals need separate batch runs.
+void record_submission(const char* name, const char* job_class, int priority,
+                       const char* hash_path, const char* attack, int target_count) {
+    FILE* out = fopen(trace_path, "a");
+    if (!out) {
+        printf("Warning: Cannot append to trace %s\n", trace_path);
+        return;
+    }
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    fprintf(out, "%.3f %s %s %d md5 %s %s %d\n", now.tv_sec + now.tv_nsec / 1e9,
+            name, job_class, priority, hash_path, attack, target_count);
+    fclose(out);
+}
+
+typedef struct {
+    char name[MAX_JOB_NAME];
+    candidate_mask mask;
+    target_entry* targets;          // Shared by every mask of one job line
+    int target_count;
+    int owner;                      // Frees and writes `targets`
+    int priority;                   // Higher runs first
+    int* merged_ids;                // Each target's id in the merged set
+} batch_job;
+
+// Pool the targets of every job running `attack`, dropping duplicate
+// digests; each of those jobs' merged_ids point into the returned set
+target_entry* merge_job_targets(batch_job* jobs, int job_count, const char* attack,
+                                int* merged_count) {
+    int total = 0;
+    for (int j = 0; j < job_count; j++) {
+        if (strcmp(jobs[j].mask.text, attack) == 0) {
+            total += jobs[j].target_count;
+        }
+    }
+
+    // Pooled and merged copies both exist until the duplicates are dropped
+    if (!reserve_memory(MEM_TARGETS, 2ULL * total * sizeof(target_entry))) {
+        printf("Error: Merging %d targets for %s exceeds the memory budget\n", total, attack);
+        return NULL;
+    }
+    target_entry* pooled = malloc((total + 1) * sizeof(target_entry));
+    int n = 0;
+    for (int j = 0; j < job_count; j++) {
+        if (strcmp(jobs[j].mask.text, attack) == 0) {
+            memcpy(pooled + n, jobs[j].targets, jobs[j].target_count * sizeof(target_entry));
+            n += jobs[j].target_count;
+        }
+    }
+
+    int* sorted = sort_target_ids(pooled, total);
+    target_entry* merged = malloc((total + 1) * sizeof(target_entry));
+    *merged_count = 0;
+    for (int i = 0; i < total; i++) {
+        if (i == 0 || memcmp(pooled[sorted[i]].digest, pooled[sorted[i - 1]].digest,
+                             MD5_DIGEST_LENGTH) != 0) {
+            merged[*merged_count] = pooled[sorted[i]];
+            merged[*merged_count].next_alias = -1;
+            merged[*merged_count].duplicate = 0;
+            (*merged_count)++;
+        }
+    }
+    free(sorted);
+    free(pooled);
+    release_memory(MEM_TARGETS, (2ULL * total - *merged_count) * sizeof(target_entry));
+
+    // The merged set is in digest order, so ids are found by binary search
+    int* identity = malloc((*merged_count + 1) * sizeof(int));
+    for (int i = 0; i < *merged_count; i++) {
+        identity[i] = i;
+    }
+    for (int j = 0; j < job_count; j++) {
+        if (strcmp(jobs[j].mask.text, attack) != 0) {
+            continue;
+        }
+        jobs[j].merged_ids = malloc((jobs[j].target_count + 1) * sizeof(int));
+        for (int t = 0; t < jobs[j].target_count; t++) {
+            jobs[j].merged_ids[t] = find_target_rank(merged, identity, *merged_count,
+                                                     jobs[j].targets[t].digest);
+        }
+    }
+    free(identity);
+    return merged;
+}
+
+// Copy the merged outcomes back into a job's own targets.
+// Returns how many of its targets this pass cracked.
+int collect_job_hits(batch_job* job, const target_entry* merged) {
+    int cracked = 0;
+    for (int t = 0; t < job->target_count; t++) {
+        const target_entry* m = &merged[job->merged_ids[t]];
+        if (m->cracked && !job->targets[t].cracked) {
+            job->targets[t].cracked = 1;
+            job->targets[t].cracked_at = m->cracked_at;
+            strcpy(job->targets[t].password, m->password);
+            cracked++;
+        }
+    }
+    return cracked;
+}
+
+int write_job_results(const batch_job* job) {
+    char path[MAX_JOB_NAME + 16];
+    snprintf(path, sizeof(path), "%s.cracked", job->name);
+    FILE* out = fopen(path, "w");
+    int cracked = 0;
+
+    for (int t = 0; t < job->target_count; t++) {
+        if (!job->targets[t].cracked) {
+            continue;
+        }
+        char hex[MD5_DIGEST_LENGTH * 2 + 1];
+        hash_to_hex(job->targets[t].digest, hex);
+        if (out) {
+            fprintf(out, "%s:%s\n", hex, job->targets[t].password);
+        }
+        cracked++;
+    }
+
+    if (out) {
+        fclose(out);
+    }
+    return cracked;
+}
+
+// Add one job per mask of a job line. Returns the number added.
+int add_job_masks(batch_job* jobs, int job_count, const char* name, const char* attack,
+                  int priority, target_entry* targets, int target_count) {
+    char masks[MAX_JOBS][MAX_MASK_TEXT + 1];
+    int mask_count = 0;
+
+    if (attack[0] == '@') {
+        FILE* fp = fopen(attack + 1, "r");
+        if (!fp) {
+            printf("Skipping job %s: cannot open mask file %s\n", name, attack + 1);
+            return 0;
+        }
+        char line[256];
+        while (fgets(line, sizeof(line), fp) && mask_count < MAX_JOBS) {
+            if (line[0] != '#' && sscanf(line, "%20s", masks[mask_count]) == 1) {
+                mask_count++;
+            }
+        }
+        fclose(fp);
+    } else {
+        snprintf(masks[0], sizeof(masks[0]), "%s", attack);
+        mask_count = 1;
+    }
+
+    int added = 0;
+    for (int m = 0; m < mask_count && job_count + added < MAX_JOBS; m++) {
+        batch_job* job = &jobs[job_count + added];
+        if (!parse_mask(masks[m], &job->mask)) {
+            printf("Skipping mask %s for job %s: at most %d positions of ?l ?u ?d ?s ?a "
+                   "and under 2^64 candidates\n", masks[m], name, MAX_PASSWORD_LENGTH);
+            continue;
+        }
+        snprintf(job->name, sizeof(job->name), "%s", name);
+        job->targets = targets;
+        job->target_count = target_count;
+        job->owner = added == 0;
+        job->priority = priority;
+        job->merged_ids = NULL;
+        added++;
+    }
+    return added;
+}
+
+int run_batch(const char* job_path) {
+    FILE* fp = fopen(job_path, "r");
+    if (!fp) {
+        printf("Error: Cannot open job file %s\n", job_path);
+        return 0;
+    }
+
+    static batch_job jobs[MAX_JOBS];
+    int job_count = 0;
+    char line[512];
+    while (fgets(line, sizeof(line), fp) && job_count < MAX_JOBS) {
+        char name[MAX_JOB_NAME], hash_path[256], attack[256], job_class[MAX_JOB_NAME] = "default";
+        int priority = 0;
+        if (line[0] == '#' || sscanf(line, "%63s %255s %255s %63s %d", name, hash_path, attack,
+                                     job_class, &priority) < 3) {
+            continue;
+        }
+        int target_count = 0;
+        target_entry* targets = load_targets(hash_path, &target_count);
+        if (!targets || target_count == 0) {
+            printf("Skipping job %s: no MD5 digests loaded from %s\n", name, hash_path);
+            free_targets(targets, target_count);
+            continue;
+        }
+        if (trace_path) {
+            record_submission(name, job_class, priority, hash_path, attack, target_count);
+        }
+        int added = add_job_masks(jobs, job_count, name, attack, priority, targets, target_count);
+        if (added == 0) {
+            free_targets(targets, target_count);
+        }
+        job_count += added;
+    }
+    fclose(fp);
+
+    // One pass per distinct attack. The waiting job with the highest priority
+    // (the earliest on ties) leads the next pass, as in replay_trace.
+    int passes = 0;
+    for (;;) {
+        int j = -1;
+        for (int k = 0; k < job_count; k++) {
+            if (!jobs[k].merged_ids && (j < 0 || jobs[k].priority > jobs[j].priority)) {
+                j = k;
+            }
+        }
+        if (j < 0) {
+            break;
+        }
+        const char* attack = jobs[j].mask.text;
+        int merged_count = 0;
+        target_entry* merged = merge_job_targets(jobs, job_count, attack, &merged_count);
+        if (!merged) {
+            for (int k = 0; k < job_count; k++) {
+                if (strcmp(jobs[k].mask.text, attack) == 0) {
+                    jobs[k].merged_ids = calloc(1, sizeof(int));
+                }
+            }
+            continue;
+        }
+
+        char label[128];
+        int members = 0;
+        for (int k = 0; k < job_count; k++) {
+            members += strcmp(jobs[k].mask.text, attack) == 0;
+        }
+        snprintf(label, sizeof(label), "%d coalesced job%s", members, members > 1 ? "s" : "");
+        crack_targets(merged, merged_count, label, &jobs[j].mask);
+        passes++;
+
+        printf("\n");
+        for (int k = 0; k < job_count; k++) {
+            if (strcmp(jobs[k].mask.text, attack) == 0) {
+                printf("Job %s: %d new cracks from %s\n", jobs[k].name,
+                       collect_job_hits(&jobs[k], merged), attack);
+            }
+        }
+        free_targets(merged, merged_count);
+    }
+
+    printf("\n");
+    int job_lines = 0;
+    for (int j = 0; j < job_count; j++) {
+        if (jobs[j].owner) {
+            int cracked = write_job_results(&jobs[j]);
+            printf("Job %s: %d / %d cracked -> %s.cracked\n", jobs[j].name, cracked,
+                   jobs[j].target_count, jobs[j].name);
+            job_lines++;
+        }
+    }
+    printf("\n%d jobs (%d job-mask pairs) run in %d keyspace pass%s\n", job_lines, job_count,
+           passes, passes == 1 ? "" : "es");
+
+    for (int j = 0; j < job_count; j++) {
+        if (jobs[j].owner) {
+            free_targets(jobs[j].targets, jobs[j].target_count);
+        }
+        free(jobs[j].merged_ids);
+    }
+    return passes;
+}
+
+// ----------------------------------------------
+// JOB TRACE REPLAY
+// ----------------------------------------------
+// Re-submits the jobs of a trace (see record_submission) at their recorded
+// arrival times, compressed by a time scale, and schedules them the way
+// batch mode would: whenever the cracker is idle, the waiting job with the
+// highest priority (then the earliest arrival) runs, coalesced with every
+// waiting job that has the same attack. Delays are reported in wall seconds
+// of the replay, per job and per job class.
+
+#define MAX_TRACE_CLASSES 64
+
+typedef struct {
+    double arrival;                 // Replay seconds after the first submission
+    char name[MAX_JOB_NAME];
+    char job_class[MAX_JOB_NAME];
+    int priority;
+    char hash_path[256];
+    char attack[MAX_MASK_TEXT + 1];
+    double started, finished;       // Replay seconds
+    double first_crack;             // Replay seconds; < 0 if nothing cracked
+    int target_count, cracked;
+    int state;                      // 0 not arrived, 1 waiting, 2 done
+} trace_job;
+
+int compare_arrivals(const void* a, const void* b) {
+    double x = ((const trace_job*)a)->arrival, y = ((const trace_job*)b)->arrival;
+    return (x > y) - (x < y);
+}
+
+// Returns the number of jobs; arrivals are scaled and made relative
+int load_trace(const char* path, trace_job* jobs, double scale) {
+    FILE* fp = fopen(path, "r");
+    if (!fp) {
+        return -1;
+    }
+    int count = 0;
+    char line[1024];
+    while (fgets(line, sizeof(line), fp) && count < MAX_JOBS) {
+        trace_job* job = &jobs[count];
+        char algorithm[16];
+        memset(job, 0, sizeof(*job));
+        if (line[0] == '#' || sscanf(line, "%lf %63s %63s %d %15s %255s %20s", &job->arrival,
+                                     job->name, job->job_class, &job->priority, algorithm,
+                                     job->hash_path, job->attack) != 7) {
+            continue;
+        }
+        if (strcmp(algorithm, "md5") != 0 || job->attack[0] == '@') {
+            printf("Skipping trace job %s: only md5 jobs with one length or mask are replayed\n",
+                   job->name);
+            continue;
+        }
+        count++;
+    }
+    fclose(fp);
+
+    qsort(jobs, count, sizeof(trace_job), compare_arrivals);
+    double first = count > 0 ? jobs[0].arrival : 0;
+    for (int j = 0; j < count; j++) {
+        jobs[j].arrival = (jobs[j].arrival - first) / scale;
+        jobs[j].first_crack = -1;
+    }
+    return count;
+}
+
+// Run the waiting jobs that share `leader`'s attack as one coalesced pass
+void run_trace_pass(trace_job* trace, int count, int leader, double start) {
+    static batch_job jobs[MAX_JOBS];
+    int members[MAX_JOBS];
+    int job_count = 0;
+
+    for (int j = 0; j < count; j++) {
+        if (trace[j].state != 1 || strcmp(trace[j].attack, trace[leader].attack) != 0) {
+            continue;
+        }
+        trace[j].state = 2;
+        trace[j].started = omp_get_wtime() - start;
+        int target_count = 0;
+        target_entry* targets = load_targets(trace[j].hash_path, &target_count);
+        if (!targets || target_count == 0 ||
+            add_job_masks(jobs, job_count, trace[j].name, trace[j].attack, trace[j].priority,
+                          targets, target_count) != 1) {
+            printf("Trace job %s: no MD5 digests loaded from %s\n", trace[j].name, trace[j].hash_path);
+            free_targets(targets, target_count);
+            trace[j].finished = omp_get_wtime() - start;
+            continue;
+        }
+        trace[j].target_count = target_count;
+        members[job_count++] = j;
+    }
+    if (job_count == 0) {
+        return;
+    }
+
+    int merged_count = 0;
+    target_entry* merged = merge_job_targets(jobs, job_count, jobs[0].mask.text, &merged_count);
+    if (merged) {
+        char label[128];
+        snprintf(label, sizeof(label), "trace: %d coalesced job%s", job_count, job_count > 1 ? "s" : "");
+        crack_targets(merged, merged_count, label, &jobs[0].mask);
+    }
+
+    double finished = omp_get_wtime() - start;
+    for (int k = 0; k < job_count; k++) {
+        trace_job* job = &trace[members[k]];
+        job->finished = finished;
+        if (merged) {
+            collect_job_hits(&jobs[k], merged);
+        }
+        for (int t = 0; t < jobs[k].target_count; t++) {
+            const target_entry* target = &jobs[k].targets[t];
+            if (!target->cracked) {
+                continue;
+            }
+            job->cracked++;
+            double at = target->cracked_at - start;
+            if (job->first_crack < 0 || at < job->first_crack) {
+                job->first_crack = at;
+            }
+        }
+        free_targets(jobs[k].targets, jobs[k].target_count);
+        free(jobs[k].merged_ids);
+    }
+    free_targets(merged, merged_count);
+}
+
+void print_trace_report(const trace_job* trace, int count, double busy, double span, double scale) {
+    printf("\n=== Trace Replay Report (time scale %.1fx, wall seconds) ===\n", scale);
+    printf("%-16s %-12s %4s %9s %9s %9s %11s %9s\n", "Job", "Class", "Prio", "Arrival",
+           "Queued", "Service", "First crack", "Cracked");
+    for (int j = 0; j < count; j++) {
+        const trace_job* job = &trace[j];
+        char first[32] = "-";
+        if (job->first_crack >= 0) {
+            snprintf(first, sizeof(first), "%.3f", job->first_crack - job->arrival);
+        }
+        printf("%-16s %-12s %4d %9.3f %9.3f %9.3f %11s %4d/%-4d\n", job->name, job->job_class,
+               job->priority, job->arrival, job->started - job->arrival,
+               job->finished - job->started, first, job->cracked, job->target_count);
+    }
+
+    // Slowdown = response time / service time; fairness is Jain's index over
+    // the classes' mean slowdowns (1 = every class is slowed down equally)
+    char classes[MAX_TRACE_CLASSES][MAX_JOB_NAME];
+    int class_count = 0;
+    for (int j = 0; j < count; j++) {
+        int c = 0;
+        while (c < class_count && strcmp(classes[c], trace[j].job_class) != 0) {
+            c++;
+        }
+        if (c == class_count && class_count < MAX_TRACE_CLASSES) {
+            strcpy(classes[class_count++], trace[j].job_class);
+        }
+    }
+
+    printf("\n%-12s %5s %11s %11s %15s %13s\n", "Class", "Jobs", "Mean queue", "Max queue",
+           "Mean 1st crack", "Mean slowdown");
+    double sum = 0, sum_squares = 0;
+    for (int c = 0; c < class_count; c++) {
+        int jobs = 0, with_crack = 0;
+        double queued = 0, max_queued = 0, first_crack = 0, slowdown = 0;
+        for (int j = 0; j < count; j++) {
+            const trace_job* job = &trace[j];
+            if (strcmp(job->job_class, classes[c]) != 0) {
+                continue;
+            }
+            double wait = job->started - job->arrival;
+            double service = job->finished - job->started;
+            jobs++;
+            queued += wait;
+            if (wait > max_queued) {
+                max_queued = wait;
+            }
+            slowdown += (wait + service) / (service > 1e-3 ? service : 1e-3);
+            if (job->first_crack >= 0) {
+                first_crack += job->first_crack - job->arrival;
+                with_crack++;
+            }
+        }
+        slowdown /= jobs;
+        sum += slowdown;
+        sum_squares += slowdown * slowdown;
+        char first[32] = "-";
+        if (with_crack > 0) {
+            snprintf(first, sizeof(first), "%.3f", first_crack / with_crack);
+        }
+        printf("%-12s %5d %11.3f %11.3f %15s %13.2f\n", classes[c], jobs, queued / jobs,
+               max_queued, first, slowdown);
+    }
+
+    printf("\nUtilisation: %.1f%% (%.3f s busy over %.3f s from first arrival to last finish)\n",
+           span > 0 ? 100.0 * busy / span : 0, busy, span);
+    printf("Fairness (Jain's index over class slowdowns): %.3f\n",
+           class_count > 0 ? sum * sum / (class_count * sum_squares) : 1.0);
+}
+
+int replay_trace(const char* trace_path_in, double scale) {
+    static trace_job trace[MAX_JOBS];
+    int count = load_trace(trace_path_in, trace, scale);
+    if (count < 0) {
+        printf("Error: Cannot open trace %s\n", trace_path_in);
+        return 0;
+    }
+    if (count == 0) {
+        printf("Error: No replayable jobs in %s\n", trace_path_in);
+        return 0;
+    }
+
+    // Every pass must do its full work, as it did when the trace was recorded
+    ledger_path = NULL;
+    printf("Replaying %d jobs from %s, %.1fx faster than recorded\n", count, trace_path_in, scale);
+
+    double start = omp_get_wtime();
+    double busy = 0;
+    int done = 0;
+    while (done < count) {
+        double now = omp_get_wtime() - start;
+        int leader = -1, next_arrival = -1;
+        for (int j = 0; j < count; j++) {
+            if (trace[j].state == 0 && trace[j].arrival <= now) {
+                trace[j].state = 1;
+            }
+            if (trace[j].state == 0 && next_arrival < 0) {
+                next_arrival = j;
+            }
+            if (trace[j].state == 1 && (leader < 0 || trace[j].priority > trace[leader].priority)) {
+                leader = j;             // Jobs are in arrival order: ties keep the earliest
+            }
+        }
+
+        if (leader < 0) {
+            usleep((useconds_t)((trace[next_arrival].arrival - now) * 1e6));
+            continue;
+        }
+
+        double pass_start = omp_get_wtime();
+        run_trace_pass(trace, count, leader, start);
+        busy += omp_get_wtime() - pass_start;
+
+        done = 0;
+        for (int j = 0; j < count; j++) {
+            done += trace[j].state == 2;
+        }
+    }
+
+    double span = 0;
+    for (int j = 0; j < count; j++) {
+        if (trace[j].finished > span) {
+            span = trace[j].finished;
+        }
+    }
+    print_trace_report(trace, count, busy, span, scale);
+    return count;
+}
+
+// ----------------------------------------------
+// SCRYPT MODE (MEMORY-BOUND)
+// ----------------------------------------------
+// Targets use the hashcat format SCRYPT:N:r:p:<base64 salt>:<base64 hash>.
+// Each candidate in flight needs a 128*r*N byte V array, so concurrency comes
+// from the memory budget, not the core count. Each thread runs several
+// candidates ("lanes") through ROMix in lock step: the random V reads of all
+// lanes are issued together, so their cache misses overlap.
+
+#define SCRYPT_MAX_LANES 4
+#define SCRYPT_MAX_HASH 64
+#define SCRYPT_MAX_SALT 64
+#define HUGE_PAGE_SIZE (2UL << 20)
+
+typedef struct {
+    unsigned long long N;
+    unsigned int r, p;
+    unsigned char salt[SCRYPT_MAX_SALT];
+    int salt_length;
+    unsigned char hash[SCRYPT_MAX_HASH];
+    int hash_length;
+} scrypt_target;
+
+// Decode standard base64; returns the decoded length or -1
+int decode_base64(const char* text, unsigned char* out, int capacity) {
+    int length = strlen(text);
+    if (length == 0 || length % 4 != 0 || length / 4 * 3 > capacity + 2) {
+        return -1;
+    }
+    unsigned char decoded[SCRYPT_MAX_SALT + SCRYPT_MAX_HASH + 4];
+    if (length / 4 * 3 > (int)sizeof(decoded)) {
+        return -1;
+    }
+    int n = EVP_DecodeBlock(decoded, (const unsigned char*)text, length);
+    if (n < 0) {
+        return -1;
+    }
+    // EVP_DecodeBlock keeps the bytes standing in for '=' padding
+    n -= (text[length - 1] == '=') + (text[length - 2] == '=');
+    if (n > capacity) {
+        return -1;
+    }
+    memcpy(out, decoded, n);
+    return n;
+}
+
+int parse_scrypt_target(const char* text, scrypt_target* target) {
+    char salt[128], hash[128];
+    if (sscanf(text, "SCRYPT:%llu:%u:%u:%127[^:]:%127s", &target->N, &target->r, &target->p,
+               salt, hash) != 5) {
+        return 0;
+    }
+    target->salt_length = decode_base64(salt, target->salt, SCRYPT_MAX_SALT);
+    target->hash_length = decode_base64(hash, target->hash, SCRYPT_MAX_HASH);
+    return target->N >= 2 && (target->N & (target->N - 1)) == 0 &&
+           target->r >= 1 && target->p >= 1 &&
+           target->salt_length >= 0 && target->hash_length > 0;
+}
+
+#define ROTL32(a, b) (((a) << (b)) | ((a) >> (32 - (b))))
+
+void salsa20_8(unsigned int* B) {
+    unsigned int x[16];
+    memcpy(x, B, sizeof(x));
+    for (int i = 0; i < 8; i += 2) {
+        x[ 4] ^= ROTL32(x[ 0] + x[12],  7);  x[ 8] ^= ROTL32(x[ 4] + x[ 0],  9);
+        x[12] ^= ROTL32(x[ 8] + x[ 4], 13);  x[ 0] ^= ROTL32(x[12] + x[ 8], 18);
+        x[ 9] ^= ROTL32(x[ 5] + x[ 1],  7);  x[13] ^= ROTL32(x[ 9] + x[ 5],  9);
+        x[ 1] ^= ROTL32(x[13] + x[ 9], 13);  x[ 5] ^= ROTL32(x[ 1] + x[13], 18);
+        x[14] ^= ROTL32(x[10] + x[ 6],  7);  x[ 2] ^= ROTL32(x[14] + x[10],  9);
+        x[ 6] ^= ROTL32(x[ 2] + x[14], 13);  x[10] ^= ROTL32(x[ 6] + x[ 2], 18);
+        x[ 3] ^= ROTL32(x[15] + x[11],  7);  x[ 7] ^= ROTL32(x[ 3] + x[15],  9);
+        x[11] ^= ROTL32(x[ 7] + x[ 3], 13);  x[15] ^= ROTL32(x[11] + x[ 7], 18);
+        x[ 1] ^= ROTL32(x[ 0] + x[ 3],  7);  x[ 2] ^= ROTL32(x[ 1] + x[ 0],  9);
+        x[ 3] ^= ROTL32(x[ 2] + x[ 1], 13);  x[ 0] ^= ROTL32(x[ 3] + x[ 2], 18);
+        x[ 6] ^= ROTL32(x[ 5] + x[ 4],  7);  x[ 7] ^= ROTL32(x[ 6] + x[ 5],  9);
+        x[ 4] ^= ROTL32(x[ 7] + x[ 6], 13);  x[ 5] ^= ROTL32(x[ 4] + x[ 7], 18);
+        x[11] ^= ROTL32(x[10] + x[ 9],  7);  x[ 8] ^= ROTL32(x[11] + x[10],  9);
+        x[ 9] ^= ROTL32(x[ 8] + x[11], 13);  x[10] ^= ROTL32(x[ 9] + x[ 8], 18);
+        x[12] ^= ROTL32(x[15] + x[14],  7);  x[13] ^= ROTL32(x[12] + x[15],  9);
+        x[14] ^= ROTL32(x[13] + x[12], 13);  x[15] ^= ROTL32(x[14] + x[13], 18);
+    }
+    for (int i = 0; i < 16; i++) {
+        B[i] += x[i];
+    }
+}
+
+// BlockMix(in) -> out for 2r 64-byte blocks; even outputs first, then odd
+void blockmix_salsa8(const unsigned int* in, unsigned int* out, int r) {
+    unsigned int X[16];
+    memcpy(X, in + (2 * r - 1) * 16, sizeof(X));
+    for (int i = 0; i < 2 * r; i++) {
+        for (int k = 0; k < 16; k++) {
+            X[k] ^= in[i * 16 + k];
+        }
+        salsa20_8(X);
+        memcpy(out + ((i / 2) + (i & 1) * r) * 16, X, sizeof(X));
+    }
+}
+
+// ROMix on `lanes` blocks at once. X and T hold 32*r words per lane; each
+// lane's V is N rows of 32*r words inside the thread's arena.
+void romix_lanes(unsigned int** X, unsigned int** T, unsigned int** V, int lanes,
+                 unsigned long long N, int r) {
+    size_t row = 32 * (size_t)r;
+
+    for (unsigned long long i = 0; i < N; i++) {
+        for (int l = 0; l < lanes; l++) {
+            memcpy(V[l] + i * row, X[l], row * sizeof(unsigned int));
+            blockmix_salsa8(X[l], T[l], r);
+            unsigned int* swap = X[l]; X[l] = T[l]; T[l] = swap;
+        }
+    }
+
+    for (unsigned long long i = 0; i < N; i++) {
+        unsigned long long j[SCRYPT_MAX_LANES];
+        // Integerify every lane first and start all the V reads
+        for (int l = 0; l < lanes; l++) {
+            j[l] = X[l][(2 * r - 1) * 16] & (N - 1);
+            const char* v = (const char*)(V[l] + j[l] * row);
+            for (size_t b = 0; b < row * sizeof(unsigned int); b += 64) {
+                __builtin_prefetch(v + b);
+            }
+        }
+        for (int l = 0; l < lanes; l++) {
+            const unsigned int* v = V[l] + j[l] * row;
+            for (size_t k = 0; k < row; k++) {
+                X[l][k] ^= v[k];
+            }
+            blockmix_salsa8(X[l], T[l], r);
+            unsigned int* swap = X[l]; X[l] = T[l]; T[l] = swap;
+        }
+    }
+}
+
+// Per-thread scratch: V for every lane plus B, X and T buffers
+typedef struct {
+    void* memory;
+    size_t size;
+    int huge;                       // 1: explicit hugetlb pages, 0: THP hint only
+    unsigned int* V[SCRYPT_MAX_LANES];
+    unsigned char* B[SCRYPT_MAX_LANES];
+    unsigned int* X[SCRYPT_MAX_LANES];
+    unsigned int* T[SCRYPT_MAX_LANES];
+} scrypt_arena;
+
+// Explicit 2 MB pages when the system has them reserved; otherwise normal
+// pages with a transparent-hugepage hint. The caller should be the thread
+// that uses the arena: it is zeroed here, so its pages land on that
+// thread's NUMA node.
+int alloc_scrypt_arena(scrypt_arena* arena, const scrypt_target* target, int lanes) {
+    size_t row = 128 * (size_t)target->r;
+    size_t v_bytes = row * target->N;
+    size_t b_bytes = row * target->p;
+    size_t per_lane = v_bytes + b_bytes + 2 * row;
+    arena->size = (per_lane * lanes + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    if (!reserve_memory(MEM_SCRYPT, arena->size)) {
+        return 0;
+    }
+
+    arena->huge = 1;
+    arena->memory = mmap(NULL, arena->size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (arena->memory == MAP_FAILED) {
+        arena->huge = 0;
+        arena->memory = mmap(NULL, arena->size, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (arena->memory == MAP_FAILED) {
+            release_memory(MEM_SCRYPT, arena->size);
+            return 0;
+        }
+        madvise(arena->memory, arena->size, MADV_HUGEPAGE);
+    }
+    memset(arena->memory, 0, arena->size);
+
+    char* next = arena->memory;
+    for (int l = 0; l < lanes; l++) {
+        arena->V[l] = (unsigned int*)next;  next += v_bytes;
+        arena->B[l] = (unsigned char*)next; next += b_bytes;
+        arena->X[l] = (unsigned int*)next;  next += row;
+        arena->T[l] = (unsigned int*)next;  next += row;
+    }
+    return 1;
+}
+
+void free_scrypt_arena(scrypt_arena* arena) {
+    munmap(arena->memory, arena->size);
+    release_memory(MEM_SCRYPT, arena->size);
+}
+
+// scrypt of `lanes` passwords at once; out[l] receives hash_length bytes
+void scrypt_lanes(const scrypt_target* target, char passwords[][MAX_WORD_LENGTH + 1],
+                  int lanes, scrypt_arena* arena, unsigned char out[][SCRYPT_MAX_HASH],
+                  int out_length) {
+    int r = target->r;
+    size_t row = 32 * (size_t)r;
+    unsigned int* X[SCRYPT_MAX_LANES];
+    unsigned int* T[SCRYPT_MAX_LANES];
+
+    for (int l = 0; l < lanes; l++) {
+        PKCS5_PBKDF2_HMAC(passwords[l], strlen(passwords[l]), target->salt, target->salt_length,
+                          1, EVP_sha256(), 128 * r * target->p, arena->B[l]);
+    }
+
+    for (unsigned int k = 0; k < target->p; k++) {
+        // Bytes to little-endian words and back around ROMix
+        for (int l = 0; l < lanes; l++) {
+            const unsigned char* b = arena->B[l] + k * 128 * r;
+            X[l] = arena->X[l];
+            T[l] = arena->T[l];
+            for (size_t w = 0; w < row; w++) {
+                X[l][w] = b[4 * w] | b[4 * w + 1] << 8 | b[4 * w + 2] << 16 |
+                          (unsigned int)b[4 * w + 3] << 24;
+            }
+        }
+        romix_lanes(X, T, arena->V, lanes, target->N, r);
+        for (int l = 0; l < lanes; l++) {
+            unsigned char* b = arena->B[l] + k * 128 * r;
+            for (size_t w = 0; w < row; w++) {
+                b[4 * w] = X[l][w];
+                b[4 * w + 1] = X[l][w] >> 8;
+                b[4 * w + 2] = X[l][w] >> 16;
+                b[4 * w + 3] = X[l][w] >> 24;
+            }
+        }
+    }
+
+    for (int l = 0; l < lanes; l++) {
+        PKCS5_PBKDF2_HMAC(passwords[l], strlen(passwords[l]), arena->B[l], 128 * r * target->p,
+                          1, EVP_sha256(), out_length, out[l]);
+    }
+}
+
+// RFC 7914 test vector, run through the lane code before cracking.
+// Returns 1 on a match, 0 on a mismatch, -1 if its arena does not fit.
+int scrypt_self_test(void) {
+    static const char* expected =
+        "fdbabe1c9d3472007856e7190d01e9fe7c6ad7cbc8237830e77376634b373162"
+        "2eaf30d92e22a3886ff109279d9830dac727afb94a83ee6d8360cbdfa2cc0640";
+    scrypt_target target = { .N = 1024, .r = 8, .p = 16, .salt_length = 4 };
+    memcpy(target.salt, "NaCl", 4);
+
+    char passwords[2][MAX_WORD_LENGTH + 1] = { "password", "password" };
+    unsigned char out[2][SCRYPT_MAX_HASH];
+    scrypt_arena arena;
+    if (!alloc_scrypt_arena(&arena, &target, 2)) {
+        return -1;
+    }
+    scrypt_lanes(&target, passwords, 2, &arena, out, 64);
+    free_scrypt_arena(&arena);
+
+    char hex[129];
+    for (int l = 0; l < 2; l++) {
+        for (int i = 0; i < 64; i++) {
+            sprintf(hex + 2 * i, "%02x", out[l][i]);
+        }
+        if (strcmp(hex, expected) != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Search the mask with `threads` threads of `lanes` lanes each. Every thread
+// allocates its arena before any batch is claimed; if any could not, nothing
+// is searched and the number of missing arenas is returned.
+int run_scrypt_team(const scrypt_target* target, const candidate_mask* mask, int threads,
+                    int lanes, int* found, char* found_password, unsigned long long* attempts,
+                    int* huge_arenas) {
+    unsigned long long total = mask_keyspace(mask);
+    unsigned long long batches = (total + lanes - 1) / lanes;
+    unsigned long long tried = 0;
+    int missing = 0, huge = 0;
+
+    #pragma omp parallel num_threads(threads) reduction(+:tried, huge)
+    {
+        scrypt_arena arena;
+        char passwords[SCRYPT_MAX_LANES][MAX_WORD_LENGTH + 1];
+        unsigned char out[SCRYPT_MAX_LANES][SCRYPT_MAX_HASH];
+        int ok = alloc_scrypt_arena(&arena, target, lanes);
+        huge += ok && arena.huge;
+        if (!ok) {
+            #pragma omp atomic
+            missing++;
+        }
+        #pragma omp barrier
+
+        if (missing == 0) {
+            #pragma omp for schedule(dynamic)
+            for (unsigned long long b = 0; b < batches; b++) {
+                if (*found) {
+                    continue;
+                }
+                int n = 0;
+                for (unsigned long long i = b * lanes; i < total && n < lanes; i++, n++) {
+                    mask_to_password(i, mask, passwords[n], NULL);
+                }
+                scrypt_lanes(target, passwords, n, &arena, out, target->hash_length);
+                tried += n;
+
+                for (int l = 0; l < n; l++) {
+                    if (memcmp(out[l], target->hash, target->hash_length) == 0) {
+                        #pragma omp critical
+                        {
+                            *found = 1;
+                            strcpy(found_password, passwords[l]);
+                        }
+                    }
+                }
+            }
+        }
+        if (ok) {
+            free_scrypt_arena(&arena);
+        }
+    }
+
+    *attempts += tried;
+    *huge_arenas = huge;
+    return missing;
+}
+
+int crack_scrypt(const char* target_text, const candidate_mask* mask, double budget_mb) {
+    scrypt_target target;
+    if (!parse_scrypt_target(target_text, &target)) {
+        printf("Error: Expected SCRYPT:N:r:p:<base64 salt>:<base64 hash> with N a power of two\n");
+        return 0;
+    }
+    int self_test = scrypt_self_test();
+    if (self_test < 0) {
+        printf("Error: The scrypt self-test needs more memory than the budget has left\n");
+        return 0;
+    }
+    if (self_test == 0) {
+        printf("Error: scrypt self-test failed\n");
+        return 0;
+    }
+
+    // Default budget: half of the memory currently free, within the global budget
+    double available_mb = memory_available() / 1048576.0;
+    if (budget_mb <= 0) {
+        budget_mb = (double)sysconf(_SC_AVPHYS_PAGES) * sysconf(_SC_PAGESIZE) / 2 / (1 << 20);
+    }
+    if (budget_mb > available_mb) {
+        budget_mb = available_mb;
+    }
+    double candidate_mb = 128.0 * target.r * (target.N + target.p + 2) / (1 << 20);
+    long long in_flight = (long long)(budget_mb / candidate_mb);
+    if (in_flight < 1) {
+        printf("Error: One candidate needs %.1f MB, more than the %.0f MB budget\n",
+               candidate_mb, budget_mb);
+        return 0;
+    }
+    // One candidate costs about N * r * p MD5s (2N BlockMix calls of 2r Salsa20/8 cores)
+    int threads = choose_threads(mask_keyspace(mask), (double)target.N * target.r * target.p);
+    if (in_flight < threads) {
+        threads = in_flight;
+    }
+    int lanes = in_flight / threads;
+    if (lanes > SCRYPT_MAX_LANES) {
+        lanes = SCRYPT_MAX_LANES;
+    }
+
+    unsigned long long total = mask_keyspace(mask);
+    int found = 0, huge_arenas = 0;
+    char found_password[MAX_PASSWORD_LENGTH + 1];
+    unsigned long long attempts = 0;
+
+    printf("\n=== Starting scrypt Search (OpenMP) ===\n");
+    printf("Parameters: N=%llu r=%u p=%u, %d-byte salt, %d-byte hash\n",
+           target.N, target.r, target.p, target.salt_length, target.hash_length);
+    printf("Mask: %s (%llu candidates)\n", mask->text, total);
+    printf("Memory: %.1f MB per candidate, %.0f MB budget -> %d threads x %d lanes\n",
+           candidate_mb, budget_mb, threads, lanes);
+
+    double start_time = omp_get_wtime();
+
+    // A thread without an arena would leave its batches unsearched, so when
+    // some arenas do not fit, the search restarts with that many fewer threads
+    int missing_arenas;
+    while ((missing_arenas = run_scrypt_team(&target, mask, threads, lanes, &found,
+                                             found_password, &attempts, &huge_arenas)) > 0) {
+        threads -= missing_arenas;
+        if (threads < 1) {
+            printf("Error: No thread could allocate a %.1f MB scrypt arena\n", candidate_mb * lanes);
+            return 0;
+        }
+        printf("Warning: %d arenas did not fit; retrying with %d threads\n", missing_arenas, threads);
+    }
+
+    double elapsed = omp_get_wtime() - start_time;
+    printf("Arenas: %d of %d on explicit hugepages (others use transparent hugepages)\n",
+           huge_arenas, threads);
+
+    if (found) {
+        printf("\n✓ PASSWORD FOUND!\n");
+        printf("Password: %s\n", found_password);
+    } else {
+        printf("\n✗ Password NOT found\n");
+    }
+    printf("Total attempts: %llu\n", attempts);
+    printf("Execution time: %.3f seconds\n", elapsed);
+    printf("Hashes per second: %.1f\n", attempts / elapsed);
+    print_memory_report();
+    return found;
+}
+
+int main(int argc, char* argv[]) {
+    printf("========================================\n");
+    printf("Parallel Brute Force Password Cracker\n");
+    printf("Using MD5 + OpenMP\n");
+    printf("========================================\n");
+
+    // --no-speculation: turn off tail splitting to compare wall times
+    // --ledger PATH: skip work an earlier run recorded in PATH, and record this one
+    // --memory MB: memory budget (default: cgroup limit, else physical RAM)
+    // --report FILE / --metrics FILE: JSON run report / Prometheus metrics at exit
+    // --profile FILE [--profile-hz N]: sample stacks, write folded stacks at exit
+    // --stage-timing N: cycles per candidate by stage, timing one batch in N
+    // --trace FILE: append each batch-mode job submission to a replay trace
+    // --ring FILE: publish progress and hits in a shared-memory ring at FILE
+    // --threads N: always use N threads instead of sizing by the keyspace
+    // --pipeline smt|cross: multi-target search as generator/hasher pairs
+    // --pipeline compare: run the default search, smt and cross side by side
+    double memory_mb = 0;
+    while (argc >= 2 && (strncmp(argv[1], "--no-", 5) == 0 || strcmp(argv[1], "--memory") == 0 ||
+                         strcmp(argv[1], "--report") == 0 || strcmp(argv[1], "--metrics") == 0 ||
+                         strncmp(argv[1], "--profile", 9) == 0 ||
+                         strcmp(argv[1], "--stage-timing") == 0 || strcmp(argv[1], "--trace") == 0 ||
+                         strcmp(argv[1], "--ring") == 0 || strcmp(argv[1], "--threads") == 0 ||
+                         strcmp(argv[1], "--pipeline") == 0 || strcmp(argv[1], "--ledger") == 0)) {
+        if (strcmp(argv[1], "--no-speculation") == 0) {
+            speculative_tail = 0;
+        } else if (strcmp(argv[1], "--ledger") == 0 && argc >= 3) {
+            ledger_path = argv[2];
+            argv++;
+            argc--;
+        } else if (strcmp(argv[1], "--memory") == 0 && argc >= 3 && atof(argv[2]) > 0) {
+            memory_mb = atof(argv[2]);
+            argv++;
+            argc--;
+        } else if (strcmp(argv[1], "--report") == 0 && argc >= 3) {
+            report_path = argv[2];
+            argv++;
+            argc--;
+        } else if (strcmp(argv[1], "--metrics") == 0 && argc >= 3) {
+            metrics_path = argv[2];
+            argv++;
+            argc--;
+        } else if (strcmp(argv[1], "--profile") == 0 && argc >= 3) {
+            profile_path = argv[2];
+            argv++;
+            argc--;
+        } else if (strcmp(argv[1], "--profile-hz") == 0 && argc >= 3 && atoi(argv[2]) > 0 &&
+                   atoi(argv[2]) <= 10000) {
+            profile_hz = atoi(argv[2]);
+            argv++;
+            argc--;
+        } else if (strcmp(argv[1], "--stage-timing") == 0 && argc >= 3 && atoi(argv[2]) > 0) {
+            stage_sample = atoi(argv[2]);
+            argv++;
+            argc--;
+        } else if (strcmp(argv[1], "--trace") == 0 && argc >= 3) {
+            trace_path = argv[2];
+            argv++;
+            argc--;
+        } else if (strcmp(argv[1], "--threads") == 0 && argc >= 3 && atoi(argv[2]) > 0) {
+            omp_set_num_threads(atoi(argv[2]));
+            fixed_threads = 1;
+            argv++;
+            argc--;
+        } else if (strcmp(argv[1], "--pipeline") == 0 && argc >= 3 &&
+                   (strcmp(argv[2], "smt") == 0 || strcmp(argv[2], "cross") == 0 ||
+                    strcmp(argv[2], "compare") == 0)) {
+            use_pipeline = 1;
+            compare_placements = strcmp(argv[2], "compare") == 0;
+            placement = strcmp(argv[2], "cross") == 0 ? PLACEMENT_CROSS : PLACEMENT_SMT;
+            argv++;
+            argc--;
+        } else if (strcmp(argv[1], "--ring") == 0 && argc >= 3) {
+            if (!open_result_ring(argv[2])) {
+                return 1;
+            }
+            argv++;
+            argc--;
+        } else {
+            printf("Unknown option %s\n", argv[1]);
+            return 1;
+        }
+        argv++;
+        argc--;
+    }
+    init_memory_budget(memory_mb);
+    if (report_path || metrics_path) {
+        static const char* modes[][2] = {
+            { "-c", "case" }, { "-k", "keyboard-walk" }, { "-p", "passphrase" },
+            { "-t", "multi-target" }, { "-b", "batch" }, { "-s", "scrypt" },
+            { "--benchmark", "benchmark" }, { "-r", "trace-replay" }, { "--self-test", "self-test" }
+        };
+        for (int m = 0; m < 9 && argc >= 2; m++) {
+            if (strcmp(argv[1], modes[m][0]) == 0) {
+                report_mode = modes[m][1];
+            }
+        }
+        start_rss_sampler();
+        atexit(write_run_reports);
+    }
+    if (profile_path) {
+        start_profiler();
+        atexit(write_profile);
+    }
+
+    // Case-permutation mode: ./openmp_password_hash -c wordlist.txt
+    if (argc >= 3 && strcmp(argv[1], "-c") == 0) {
+        char word[MAX_WORD_LENGTH + 1];
+
+        printf("Enter password to crack (any case): ");
+        if (scanf("%55s", word) != 1) {
+            printf("Error reading password\n");
+            return 1;
+        }
+
+        crack_case_permutations(word, argv[2]);
+        return 0;
+    }
+
+    // Keyboard-walk mode: ./openmp_password_hash -k [layout] [min] [max] [turns] [shift]
+    if (argc >= 2 && strcmp(argv[1], "-k") == 0) {
+        const char* layout = argc >= 3 ? argv[2] : "qwerty";
+        int min_length = argc >= 4 ? atoi(argv[3]) : 4;
+        int max_length = argc >= 5 ? atoi(argv[4]) : 8;
+        int max_turns  = argc >= 6 ? atoi(argv[5]) : 2;
+        int shift_mode = argc >= 7 ? atoi(argv[6]) : 1;
+
+        if (min_length < 1 || max_length > MAX_WALK_LENGTH || min_length > max_length) {
+            printf("Error: Walk length must be within 1-%d\n", MAX_WALK_LENGTH);
+            return 1;
+        }
+        if (max_turns < 0 || max_turns > MAX_WALK_LENGTH - 2) {
+            printf("Error: Direction changes must be within 0-%d\n", MAX_WALK_LENGTH - 2);
+            return 1;
+        }
+        if (shift_mode < 0 || shift_mode > 2) {
+            printf("Error: Shift mode must be 0, 1 or 2\n");
+            return 1;
+        }
+
+        char word[MAX_WALK_LENGTH + 1];
+        printf("Enter password to crack: ");
+        if (scanf("%16s", word) != 1) {
+            printf("Error reading password\n");
+            return 1;
+        }
+
+        crack_keyboard_walks(word, layout, min_length, max_length, max_turns, shift_mode);
+        return 0;
+    }
+
+    // Passphrase mode: ./openmp_password_hash -p suffix_length [md5|ntlm]
+    if (argc >= 3 && strcmp(argv[1], "-p") == 0) {
+        int suffix_length = atoi(argv[2]);
+        const char* algorithm = argc >= 4 ? argv[3] : "md5";
+        int ntlm = strcmp(algorithm, "ntlm") == 0;
+        if (!ntlm && strcmp(algorithm, "md5") != 0) {
+            printf("Error: Unknown hash '%s' (use md5 or ntlm)\n", algorithm);
+            return 1;
+        }
+        char passphrase[MAX_PASSPHRASE_LENGTH + 2];
+
+        printf("Enter passphrase to crack (spaces allowed): ");
+        if (!fgets(passphrase, sizeof(passphrase), stdin)) {
+            printf("Error reading passphrase\n");
+            return 1;
+        }
+        passphrase[strcspn(passphrase, "\r\n")] = '\0';
+
+        int length = strlen(passphrase);
+        if (length > MAX_PASSPHRASE_LENGTH) {
+            printf("Error: Passphrase too long (max %d characters)\n", MAX_PASSPHRASE_LENGTH);
+            return 1;
+        }
+        if (ntlm && length > MAX_NTLM_PASSPHRASE_LENGTH) {
+            printf("Error: NTLM passphrase too long (max %d characters)\n",
+                   MAX_NTLM_PASSPHRASE_LENGTH);
+            return 1;
+        }
+        for (int i = 0; ntlm && i < length; i++) {
+            if ((unsigned char)passphrase[i] > 0x7f) {
+                printf("Error: NTLM passphrases must be ASCII\n");
+                return 1;
+            }
+        }
+        if (suffix_length < 1 || suffix_length > MAX_PASSWORD_LENGTH || suffix_length > length) {
+            printf("Error: Suffix length must be within 1-%d and fit the passphrase\n",
+                   MAX_PASSWORD_LENGTH);
+            return 1;
+        }
+        for (int i = length - suffix_length; i < length; i++) {
+            if (passphrase[i] < 'a' || passphrase[i] > 'z') {
+                printf("Error: Suffix must contain only a-z lowercase\n");
+                return 1;
+            }
+        }
+
+        crack_passphrase_parallel(passphrase, suffix_length, ntlm);
+        return 0;
+    }
+
+    // Multi-target mode: ./openmp_password_hash -t hashes.txt <length|mask>
+    if (argc >= 4 && strcmp(argv[1], "-t") == 0) {
+        candidate_mask mask;
+        if (!parse_mask(argv[3], &mask)) {
+            printf("Error: Give a length within 1-%d or a mask of at most %d positions "
+                   "and under 2^64 candidates\n", MAX_PASSWORD_LENGTH, MAX_PASSWORD_LENGTH);
+            return 1;
+        }
+        crack_target_list(argv[2], &mask);
+        return 0;
+    }
+
+    // Batch mode: ./openmp_password_hash -b jobs.txt
+    if (argc >= 3 && strcmp(argv[1], "-b") == 0) {
+        run_batch(argv[2]);
+        return 0;
+    }
+
+    // Trace replay: ./openmp_password_hash -r trace.txt [time_scale]
+    if (argc >= 3 && strcmp(argv[1], "-r") == 0) {
+        double scale = argc >= 4 ? atof(argv[3]) : 1;
+        if (scale <= 0) {
+            printf("Error: Time scale must be positive\n");
+            return 1;
+        }
+        replay_trace(argv[2], scale);
+        return 0;
+    }
+
+    // scrypt mode: ./openmp_password_hash -s 'SCRYPT:N:r:p:salt:hash' <length|mask> [memory_MB]
+    if (argc >= 4 && strcmp(argv[1], "-s") == 0) {
+        candidate_mask mask;
+        if (!parse_mask(argv[3], &mask)) {
+            printf("Error: Give a length within 1-%d or a mask of at most %d positions "
+                   "and under 2^64 candidates\n", MAX_PASSWORD_LENGTH, MAX_PASSWORD_LENGTH);
+            return 1;
+        }
+        crack_scrypt(argv[2], &mask, argc >= 5 ? atof(argv[4]) : 0);
+        return 0;
+    }
+
+    // Benchmark: ./openmp_password_hash --benchmark
+    if (argc >= 2 && strcmp(argv[1], "--benchmark") == 0) {
+        printf("Threads: %d\n", omp_get_max_threads());
+        printf("Hash rate: %.0f H/s\n", benchmark_hash_rate(3.0));
+        return 0;
+    }
+
+    // Self-test: ./openmp_password_hash --self-test
+    if (argc >= 2 && strcmp(argv[1], "--self-test") == 0) {
+        int lookups = lookup_self_test();
+        int scrypt = scrypt_self_test();
+        printf("Lookups: %s\n", lookups == 1 ? "ok" : lookups < 0 ? "skipped (memory budget)" : "FAILED");
+        printf("scrypt: %s\n", scrypt == 1 ? "ok" : scrypt < 0 ? "skipped (memory budget)" : "FAILED");
+        return lookups == 0 || scrypt == 0;
+    }
 
     char password[MAX_PASSWORD_LENGTH + 1];
 
@@ -0,0 +1,176 @@
+// mask_generator.c
+// Compile with: gcc -O2 mask_generator.c -o mask_generator
+//
+// Derive a mask set from cracked plaintexts. Every plaintext is reduced to
+// its mask (?l ?u ?d ?s per character). Masks are then ranked by cracks per
+// candidate of keyspace, and the best ones are kept until the time budget
+// runs out at the given hash rate. The output is a mask file for the OpenMP
+// batch mode (@file).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+// Configuration (matches openmp_password_hash.c)
+#define MAX_PASSWORD_LENGTH 10
+#define MAX_MASK_TEXT (2 * MAX_PASSWORD_LENGTH)
+#define DEFAULT_OUTPUT "generated.masks"
+
+typedef struct {
+    char text[MAX_MASK_TEXT + 1];
+    long long cracks;
+    unsigned long long keyspace;
+    double seconds;
+} mask_stat;
+
+// Strip a "<32 hex>:" potfile prefix if present
+const char* plaintext_of(const char* line) {
+    for (int i = 0; i < 32; i++) {
+        if (!isxdigit((unsigned char)line[i])) {
+            return line;
+        }
+    }
+    return line[32] == ':' ? line + 33 : line;
+}
+
+// Mask of a plaintext; returns 0 for empty, overlong or non-ASCII words
+int mask_of(const char* word, char* mask, unsigned long long* keyspace) {
+    int length = strlen(word);
+    if (length == 0 || length > MAX_PASSWORD_LENGTH) {
+        return 0;
+    }
+
+    *keyspace = 1;
+    for (int i = 0; i < length; i++) {
+        unsigned char c = word[i];
+        char set;
+        int size;
+        if (islower(c)) {
+            set = 'l'; size = 26;
+        } else if (isupper(c)) {
+            set = 'u'; size = 26;
+        } else if (isdigit(c)) {
+            set = 'd'; size = 10;
+        } else if (c >= 0x20 && c < 0x7f) {
+            set = 's'; size = 33;
+        } else {
+            return 0;
+        }
+        mask[2 * i] = '?';
+        mask[2 * i + 1] = set;
+        *keyspace *= size;
+    }
+    mask[2 * length] = '\0';
+    return 1;
+}
+
+int compare_text(const void* a, const void* b) {
+    return strcmp(((const mask_stat*)a)->text, ((const mask_stat*)b)->text);
+}
+
+// Highest cracks per candidate first
+int compare_yield(const void* a, const void* b) {
+    const mask_stat* x = a;
+    const mask_stat* y = b;
+    double dx = (double)x->cracks / x->keyspace;
+    double dy = (double)y->cracks / y->keyspace;
+    return (dx < dy) - (dx > dy);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 4) {
+        printf("Usage: %s <potfile|corpus> <budget_seconds> <hash_rate> [output]\n", argv[0]);
+        printf("  hash_rate: H/s as printed by ./openmp_password_hash --benchmark\n");
+        return 1;
+    }
+
+    const char* corpus_path = argv[1];
+    double budget = atof(argv[2]);
+    double rate = atof(argv[3]);
+    const char* output_path = argc >= 5 ? argv[4] : DEFAULT_OUTPUT;
+    if (budget <= 0 || rate <= 0) {
+        printf("Error: Budget and hash rate must be positive\n");
+        return 1;
+    }
+
+    FILE* fp = fopen(corpus_path, "r");
+    if (!fp) {
+        printf("Error: Cannot open %s\n", corpus_path);
+        return 1;
+    }
+
+    // One entry per usable plaintext, then sorted and merged per mask
+    int capacity = 1024, count = 0;
+    long long lines = 0;
+    mask_stat* stats = malloc(capacity * sizeof(mask_stat));
+    char line[512];
+    while (fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        lines++;
+        if (count == capacity) {
+            capacity *= 2;
+            stats = realloc(stats, capacity * sizeof(mask_stat));
+        }
+        if (mask_of(plaintext_of(line), stats[count].text, &stats[count].keyspace)) {
+            stats[count].cracks = 1;
+            count++;
+        }
+    }
+    fclose(fp);
+
+    qsort(stats, count, sizeof(mask_stat), compare_text);
+    int distinct = 0;
+    for (int i = 0; i < count; i++) {
+        if (distinct > 0 && strcmp(stats[distinct - 1].text, stats[i].text) == 0) {
+            stats[distinct - 1].cracks++;
+        } else {
+            stats[distinct++] = stats[i];
+        }
+    }
+    for (int i = 0; i < distinct; i++) {
+        stats[i].seconds = stats[i].keyspace / rate;
+    }
+    qsort(stats, distinct, sizeof(mask_stat), compare_yield);
+
+    printf("Corpus: %s (%lld lines, %d usable, %d distinct masks)\n",
+           corpus_path, lines, count, distinct);
+    printf("Budget: %.0f seconds at %.0f H/s\n\n", budget, rate);
+
+    FILE* out = fopen(output_path, "w");
+    if (!out) {
+        printf("Error: Cannot write %s\n", output_path);
+        free(stats);
+        return 1;
+    }
+    fprintf(out, "# Masks from %s, budget %.0f s at %.0f H/s, best yield first\n",
+           corpus_path, budget, rate);
+    fprintf(out, "# mask cracks keyspace seconds\n");
+
+    // Greedy by yield: a mask that doesn't fit the rest of the budget is
+    // skipped, but cheaper ones after it may still fit
+    double spent = 0;
+    long long covered = 0;
+    int selected = 0;
+    printf("%-22s %8s %16s %12s\n", "Mask", "Cracks", "Keyspace", "Seconds");
+    for (int i = 0; i < distinct; i++) {
+        if (spent + stats[i].seconds > budget) {
+            continue;
+        }
+        spent += stats[i].seconds;
+        covered += stats[i].cracks;
+        selected++;
+        fprintf(out, "%s %lld %llu %.3f\n", stats[i].text, stats[i].cracks,
+                stats[i].keyspace, stats[i].seconds);
+        printf("%-22s %8lld %16llu %12.3f\n", stats[i].text, stats[i].cracks,
+               stats[i].keyspace, stats[i].seconds);
+    }
+    fclose(out);
+
+    printf("\nSelected %d masks: %.1f of %.0f seconds, %lld / %d corpus passwords (%.1f%%)\n",
+           selected, spent, budget, covered, count, count ? 100.0 * covered / count : 0.0);
+    printf("Mask file: %s\n", output_path);
+
+    free(stats);
+    return 0;
+}
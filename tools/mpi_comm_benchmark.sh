@@ -0,0 +1,46 @@
+#!/bin/bash
+# mpi_comm_benchmark.sh
+# Sweep the MPI brute-force loop over check intervals, chunk sizes and rank
+# counts on localhost, and write one CSV row per setting:
+#   - throughput with no hit, with communication on and off (--no-comm)
+#   - the fraction of loop time spent in the periodic MPI checks
+#   - termination latency after a hit planted halfway through the keyspace
+#
+# Usage: ./mpi_comm_benchmark.sh [binary] [length] [output.csv]
+# Override the sweep with RANKS, INTERVALS and CHUNKS, e.g.
+#   RANKS="1 2 4" INTERVALS="10000 50000" ./mpi_comm_benchmark.sh
+
+BINARY=${1:-../mpi/mpi_password_hash}
+LENGTH=${2:-6}
+OUTPUT=${3:-mpi_comm_benchmark.csv}
+RANKS=${RANKS:-"1 2 4 8 16 32 64"}
+INTERVALS=${INTERVALS:-"1000 10000 50000 250000"}
+CHUNKS=${CHUNKS:-"1 1024 65536"}
+MPIRUN=${MPIRUN:-"mpirun --oversubscribe"}
+
+# Fields of a RESULT line:
+# ranks,length,interval,chunk,comm,target,candidates,seconds,rate,mpi_fraction,latency
+run() {
+    $MPIRUN -np "$1" "$BINARY" "${@:2}" | grep '^RESULT,' | cut -d, -f2-
+}
+
+echo "ranks,length,check_interval,chunk,rate_comm,rate_no_comm,throughput_loss,mpi_fraction,termination_latency" > "$OUTPUT"
+
+for ranks in $RANKS; do
+    # The baseline does not depend on the check interval
+    for chunk in $CHUNKS; do
+        baseline=$(run "$ranks" --no-comm --chunk "$chunk" -B "$LENGTH" | cut -d, -f9)
+        for interval in $INTERVALS; do
+            comm=$(run "$ranks" --check-interval "$interval" --chunk "$chunk" -B "$LENGTH")
+            planted=$(run "$ranks" --check-interval "$interval" --chunk "$chunk" -B "$LENGTH" 0.5)
+            rate=$(echo "$comm" | cut -d, -f9)
+            fraction=$(echo "$comm" | cut -d, -f10)
+            latency=$(echo "$planted" | cut -d, -f11)
+            loss=$(awk -v c="$rate" -v b="$baseline" 'BEGIN { printf "%.4f", (b > 0 ? 1 - c / b : 0) }')
+
+            echo "$ranks,$LENGTH,$interval,$chunk,$rate,$baseline,$loss,$fraction,$latency" | tee -a "$OUTPUT"
+        done
+    done
+done
+
+echo "Results written to $OUTPUT"
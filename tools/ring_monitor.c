@@ -0,0 +1,211 @@
+// ring_monitor.c
+// Compile with: gcc -O2 ring_monitor.c -o ring_monitor
+//
+// Follow a running openmp_password_hash through the shared-memory ring it
+// publishes with --ring FILE. Hits are printed as "hash:password" as soon as
+// they are published and progress at most once per interval. The ring is
+// read in place: no socket, no copies through the kernel, and no syscalls
+// while there is something to read. When there is nothing new, the monitor
+// sleeps on the ring's futex until the writer publishes again.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+// Layout (matches openmp_password_hash.c)
+#define MAX_PASSWORD_LENGTH 10
+#define RING_MAGIC 0x474e4952u
+#define RING_VERSION 1
+#define RING_HITS 4096
+#define RING_ATTACK_TEXT 32
+
+typedef struct {
+    unsigned long long seq;
+    unsigned long long index;
+    unsigned int pass;
+    unsigned char digest[16];
+    char password[MAX_PASSWORD_LENGTH + 1];
+} ring_hit;
+
+typedef struct {
+    unsigned int pass;
+    int targets;
+    int cracked;
+    char attack[RING_ATTACK_TEXT];
+    unsigned long long completed;
+    unsigned long long total;
+    unsigned long long attempts;
+    double elapsed;
+} ring_progress;
+
+typedef struct {
+    unsigned int magic;
+    unsigned int version;
+    unsigned int capacity;
+    int writer_pid;
+    int finished;
+    unsigned int progress_seq;
+    ring_progress progress;
+    unsigned long long hit_head;
+    unsigned int wake __attribute__((aligned(64)));
+    unsigned int waiters;
+    ring_hit hits[RING_HITS] __attribute__((aligned(64)));
+} result_ring;
+
+double now_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// Wait for the writer to create and initialize the ring
+result_ring* map_ring(const char* path, double timeout) {
+    double deadline = now_seconds() + timeout;
+    for (;;) {
+        int fd = open(path, O_RDWR);       // Clients write `waiters`
+        if (fd >= 0) {
+            off_t size = lseek(fd, 0, SEEK_END);
+            result_ring* ring = NULL;
+            if (size == (off_t)sizeof(result_ring)) {
+                void* map = mmap(NULL, sizeof(result_ring), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                ring = map == MAP_FAILED ? NULL : map;
+            }
+            close(fd);
+            if (ring && __atomic_load_n(&ring->magic, __ATOMIC_ACQUIRE) == RING_MAGIC) {
+                return ring;
+            }
+            if (ring) {
+                munmap(ring, sizeof(result_ring));
+            }
+        }
+        if (now_seconds() > deadline) {
+            return NULL;
+        }
+        usleep(100000);
+    }
+}
+
+// Consistent copy of the progress snapshot
+void read_progress(const result_ring* ring, ring_progress* progress) {
+    for (;;) {
+        unsigned int before = __atomic_load_n(&ring->progress_seq, __ATOMIC_ACQUIRE);
+        if (before & 1) {
+            continue;
+        }
+        *progress = ring->progress;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&ring->progress_seq, __ATOMIC_RELAXED) == before) {
+            return;
+        }
+    }
+}
+
+// Copy hit `n`; returns 0 if the writer has already reused its slot
+int read_hit(const result_ring* ring, unsigned long long n, ring_hit* hit) {
+    const ring_hit* slot = &ring->hits[n % RING_HITS];
+    if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != n + 1) {
+        return 0;
+    }
+    *hit = *slot;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&slot->seq, __ATOMIC_RELAXED) == n + 1;
+}
+
+void print_progress(const ring_progress* p) {
+    printf("[pass %u %s] %.1f%%, %d / %d cracked, %.0f H/s\n", p->pass, p->attack,
+           p->total ? 100.0 * p->completed / p->total : 0.0, p->cracked, p->targets,
+           p->elapsed > 0 ? p->attempts / p->elapsed : 0.0);
+    fflush(stdout);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        printf("Usage: %s <ring_file> [progress_interval_seconds]\n", argv[0]);
+        printf("  ring_file: as given to ./openmp_password_hash --ring\n");
+        return 1;
+    }
+    double interval = argc >= 3 ? atof(argv[2]) : 1;
+
+    result_ring* ring = map_ring(argv[1], 10);
+    if (!ring) {
+        printf("Error: No result ring at %s\n", argv[1]);
+        return 1;
+    }
+    if (ring->version != RING_VERSION || ring->capacity != RING_HITS) {
+        printf("Error: Ring %s has version %u and %u slots, expected %d and %d\n", argv[1],
+               ring->version, ring->capacity, RING_VERSION, RING_HITS);
+        return 1;
+    }
+
+    unsigned long long tail = 0, dropped = 0;
+    ring_progress progress, shown = { 0 };
+    double shown_at = 0;
+    for (;;) {
+        // Any publish after this load changes `wake`, so the wait below
+        // cannot miss it
+        unsigned int seen = __atomic_load_n(&ring->wake, __ATOMIC_SEQ_CST);
+        int finished = __atomic_load_n(&ring->finished, __ATOMIC_ACQUIRE);
+
+        unsigned long long head = __atomic_load_n(&ring->hit_head, __ATOMIC_ACQUIRE);
+        if (head - tail > RING_HITS) {
+            dropped += head - RING_HITS - tail;
+            tail = head - RING_HITS;
+        }
+        for (; tail < head; tail++) {
+            ring_hit hit;
+            if (!read_hit(ring, tail, &hit)) {
+                dropped++;
+                continue;
+            }
+            for (int i = 0; i < 16; i++) {
+                printf("%02x", hit.digest[i]);
+            }
+            printf(":%s\n", hit.password);
+        }
+
+        // A new pass and the last snapshot are always shown
+        read_progress(ring, &progress);
+        int changed = progress.pass != shown.pass || progress.completed != shown.completed ||
+                      progress.cracked != shown.cracked;
+        if (progress.pass > 0 && changed && (progress.pass != shown.pass || finished ||
+                                             now_seconds() - shown_at >= interval)) {
+            print_progress(&progress);
+            shown = progress;
+            shown_at = now_seconds();
+        }
+        fflush(stdout);
+
+        if (finished) {
+            break;
+        }
+        if (kill(ring->writer_pid, 0) != 0 && errno == ESRCH) {
+            printf("Writer %d exited without closing the ring\n", ring->writer_pid);
+            break;
+        }
+
+        // Sleep until the next publish; the timeout notices a killed writer
+        struct timespec timeout = { 1, 0 };
+        __atomic_add_fetch(&ring->waiters, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&ring->wake, __ATOMIC_SEQ_CST) == seen) {
+            syscall(SYS_futex, &ring->wake, FUTEX_WAIT, seen, &timeout, NULL, 0);
+        }
+        __atomic_sub_fetch(&ring->waiters, 1, __ATOMIC_SEQ_CST);
+    }
+
+    printf("%llu hits read", tail - dropped);
+    if (dropped > 0) {
+        printf(", %llu dropped (overwritten before they were read)", dropped);
+    }
+    printf("\n");
+    munmap(ring, sizeof(result_ring));
+    return 0;
+}
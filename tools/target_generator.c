@@ -0,0 +1,384 @@
+// target_generator.c
+// Compile with: gcc -O2 target_generator.c -lcrypto -o target_generator
+//
+// Write a synthetic MD5 target dump with known plaintexts, for repeatable
+// multi-target benchmarks. A given fraction of the plaintexts is drawn from
+// the attack's keyspace (a length, a mask, or @file of masks as written by
+// mask_generator); the rest are random words that no mask of the attack can
+// produce. Outputs, for a prefix P:
+//   P.txt    one hex digest per line (openmp_password_hash -t P.txt ...)
+//   P.bin    the same digests as raw 16-byte records (-t P.bin ...)
+//   P.truth  "hex:plaintext:1" for targets in the keyspace, ":0" otherwise
+// The same arguments and seed always produce the same files.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <openssl/md5.h>
+
+// Configuration (matches openmp_password_hash.c)
+#define MAX_PASSWORD_LENGTH 10
+#define MAX_MASK_TEXT (2 * MAX_PASSWORD_LENGTH)
+#define MAX_WORD_LENGTH 55
+#define MAX_MASKS 256
+#define MAX_TARGETS 1000000000LL
+#define DEFAULT_PREFIX "targets"
+
+#define MASK_LOWER "abcdefghijklmnopqrstuvwxyz"
+#define MASK_UPPER "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+#define MASK_DIGITS "0123456789"
+#define MASK_SYMBOLS " !\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~"
+#define MASK_ALL MASK_LOWER MASK_UPPER MASK_DIGITS MASK_SYMBOLS
+
+typedef struct {
+    int length;
+    const char* sets[MAX_PASSWORD_LENGTH];
+    int sizes[MAX_PASSWORD_LENGTH];
+    char literals[MAX_PASSWORD_LENGTH][2];
+    char text[MAX_MASK_TEXT + 1];
+    unsigned long long keyspace;
+    double weight;              // Share of the in-keyspace targets
+    unsigned long long targets; // Targets taken from this mask so far
+    unsigned long long drawn;   // Draws so far, including ones owned by another mask
+    unsigned long long stride;  // Coprime with keyspace: draws are distinct
+    unsigned long long offset;
+} attack_mask;
+
+// splitmix64: small, fast and fully determined by the seed
+unsigned long long next_random(unsigned long long* state) {
+    unsigned long long z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+unsigned long long gcd(unsigned long long a, unsigned long long b) {
+    while (b) {
+        unsigned long long t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+// Same syntax as the cracker: ?l ?u ?d ?s ?a ??, literals, or a plain length
+int parse_mask(const char* text, attack_mask* mask) {
+    char expanded[MAX_MASK_TEXT + 1];
+    int n = atoi(text);
+    if (n > 0 && strspn(text, "0123456789") == strlen(text)) {
+        if (n > MAX_PASSWORD_LENGTH) {
+            return 0;
+        }
+        for (int i = 0; i < n; i++) {
+            memcpy(expanded + 2 * i, "?l", 2);
+        }
+        expanded[2 * n] = '\0';
+        text = expanded;
+    }
+    if (strlen(text) > MAX_MASK_TEXT) {
+        return 0;
+    }
+
+    mask->length = 0;
+    mask->keyspace = 1;
+    for (const char* c = text; *c; c++) {
+        if (mask->length == MAX_PASSWORD_LENGTH) {
+            return 0;
+        }
+        const char* set = NULL;
+        if (*c == '?') {
+            c++;
+            switch (*c) {
+                case 'l': set = MASK_LOWER; break;
+                case 'u': set = MASK_UPPER; break;
+                case 'd': set = MASK_DIGITS; break;
+                case 's': set = MASK_SYMBOLS; break;
+                case 'a': set = MASK_ALL; break;
+                case '?': break;
+                default: return 0;
+            }
+        }
+        int p = mask->length++;
+        if (!set) {
+            mask->literals[p][0] = *c;
+            mask->literals[p][1] = '\0';
+            set = mask->literals[p];
+        }
+        mask->sets[p] = set;
+        mask->sizes[p] = strlen(set);
+        if (mask->keyspace > ~0ULL / mask->sizes[p]) {
+            return 0;               // Keyspace does not fit 64 bits
+        }
+        mask->keyspace *= mask->sizes[p];
+    }
+    strcpy(mask->text, text);
+    return mask->length > 0;
+}
+
+// One mask, or "@file" with "mask [weight ...]" lines; without a weight
+// column, masks are weighted by keyspace. Returns the number of masks.
+int load_masks(const char* spec, attack_mask* masks) {
+    if (spec[0] != '@') {
+        if (!parse_mask(spec, &masks[0])) {
+            return 0;
+        }
+        masks[0].weight = 1;
+        return 1;
+    }
+
+    FILE* fp = fopen(spec + 1, "r");
+    if (!fp) {
+        printf("Error: Cannot open %s\n", spec + 1);
+        return 0;
+    }
+    int count = 0;
+    char line[256];
+    while (count < MAX_MASKS && fgets(line, sizeof(line), fp)) {
+        char text[64];
+        double weight = 0;
+        if (line[0] == '#' || sscanf(line, "%63s %lf", text, &weight) < 1) {
+            continue;
+        }
+        if (!parse_mask(text, &masks[count])) {
+            printf("Warning: Skipping mask %s\n", text);
+            continue;
+        }
+        masks[count].weight = weight > 0 ? weight : (double)masks[count].keyspace;
+        count++;
+    }
+    fclose(fp);
+    return count;
+}
+
+int in_mask(const attack_mask* mask, const char* word, int length) {
+    if (length != mask->length) {
+        return 0;
+    }
+    for (int p = 0; p < length; p++) {
+        if (!strchr(mask->sets[p], word[p])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Candidate `index` of the mask, in the cracker's order
+void mask_to_password(unsigned long long index, const attack_mask* mask, char* password) {
+    for (int p = mask->length - 1; p >= 0; p--) {
+        password[p] = mask->sets[p][index % mask->sizes[p]];
+        index /= mask->sizes[p];
+    }
+    password[mask->length] = '\0';
+}
+
+// k-th draw of a mask: an affine map over its keyspace, so the first
+// `keyspace` draws never repeat
+void draw_from_mask(attack_mask* mask, char* password) {
+    unsigned __int128 index = (unsigned __int128)mask->stride * mask->drawn + mask->offset;
+    mask_to_password((unsigned long long)(index % mask->keyspace), mask, password);
+    mask->drawn++;
+}
+
+// A plaintext in several masks belongs to the first of them. Draws another
+// mask owns are skipped, so overlapping masks in an @file do not produce the
+// same plaintext twice. Returns 0 if the draw had to repeat a plaintext: the
+// mask is used up, or MAX_OWNED_SKIPS draws in a row were owned elsewhere.
+#define MAX_OWNED_SKIPS 1000
+
+int draw_owned(attack_mask* masks, int m, char* password) {
+    for (int skips = 0; masks[m].drawn < masks[m].keyspace && skips < MAX_OWNED_SKIPS; skips++) {
+        draw_from_mask(&masks[m], password);
+        int owned = 0;
+        for (int j = 0; j < m && !owned; j++) {
+            owned = in_mask(&masks[j], password, masks[m].length);
+        }
+        if (!owned) {
+            return 1;
+        }
+    }
+    draw_from_mask(&masks[m], password);
+    return 0;
+}
+
+// Random word over `charset`, retried until no attack mask matches it
+int draw_outside(const attack_mask* masks, int mask_count, const char* charset,
+                 int min_length, int max_length, unsigned long long* state, char* word) {
+    int charset_size = strlen(charset);
+    for (int attempt = 0; attempt < 1000; attempt++) {
+        int length = min_length + next_random(state) % (max_length - min_length + 1);
+        for (int i = 0; i < length; i++) {
+            word[i] = charset[next_random(state) % charset_size];
+        }
+        word[length] = '\0';
+
+        int inside = 0;
+        for (int m = 0; m < mask_count && !inside; m++) {
+            inside = in_mask(&masks[m], word, length);
+        }
+        if (!inside) {
+            return length;
+        }
+    }
+    return 0;
+}
+
+// Build a charset from mask classes (e.g. "?l?d"); other characters are taken as-is
+void expand_charset(const char* spec, char* charset) {
+    charset[0] = '\0';
+    for (const char* c = spec; *c; c++) {
+        if (*c == '?' && c[1]) {
+            c++;
+            switch (*c) {
+                case 'l': strcat(charset, MASK_LOWER); continue;
+                case 'u': strcat(charset, MASK_UPPER); continue;
+                case 'd': strcat(charset, MASK_DIGITS); continue;
+                case 's': strcat(charset, MASK_SYMBOLS); continue;
+                case 'a': strcat(charset, MASK_ALL); continue;
+            }
+        }
+        if (!strchr(charset, *c)) {
+            strncat(charset, c, 1);
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        printf("Usage: %s <count> <length|mask|@maskfile> [options]\n", argv[0]);
+        printf("  -f <fraction>  share of targets inside the attack keyspace (default 0.5)\n");
+        printf("  -l <min-max>   lengths of the other targets (default 6-12)\n");
+        printf("  -c <charset>   characters of the other targets, classes allowed (default ?l?u?d)\n");
+        printf("  -s <seed>      random seed (default 1)\n");
+        printf("  -o <prefix>    output prefix (default %s)\n", DEFAULT_PREFIX);
+        return 1;
+    }
+
+    long long count = atoll(argv[1]);
+    static attack_mask masks[MAX_MASKS];
+    int mask_count = load_masks(argv[2], masks);
+    double fraction = 0.5;
+    int min_length = 6, max_length = 12;
+    const char* charset_spec = "?l?u?d";
+    unsigned long long seed = 1;
+    const char* prefix = DEFAULT_PREFIX;
+
+    for (int i = 3; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-f") == 0) {
+            fraction = atof(argv[i + 1]);
+        } else if (strcmp(argv[i], "-l") == 0) {
+            if (sscanf(argv[i + 1], "%d-%d", &min_length, &max_length) == 1) {
+                max_length = min_length;
+            }
+        } else if (strcmp(argv[i], "-c") == 0) {
+            charset_spec = argv[i + 1];
+        } else if (strcmp(argv[i], "-s") == 0) {
+            seed = strtoull(argv[i + 1], NULL, 10);
+        } else if (strcmp(argv[i], "-o") == 0) {
+            prefix = argv[i + 1];
+        } else {
+            printf("Error: Unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if (count < 1 || count > MAX_TARGETS) {
+        printf("Error: Count must be within 1-%lld\n", MAX_TARGETS);
+        return 1;
+    }
+    if (mask_count == 0) {
+        printf("Error: Give a length within 1-%d, a mask of at most %d positions, or @maskfile\n",
+               MAX_PASSWORD_LENGTH, MAX_PASSWORD_LENGTH);
+        return 1;
+    }
+    if (fraction < 0 || fraction > 1) {
+        printf("Error: Fraction must be within 0-1\n");
+        return 1;
+    }
+    if (min_length < 1 || max_length > MAX_WORD_LENGTH || min_length > max_length) {
+        printf("Error: Lengths must be within 1-%d\n", MAX_WORD_LENGTH);
+        return 1;
+    }
+    char charset[256];
+    expand_charset(charset_spec, charset);
+    if (charset[0] == '\0') {
+        printf("Error: Empty charset\n");
+        return 1;
+    }
+
+    unsigned long long state = seed;
+    double total_weight = 0;
+    for (int m = 0; m < mask_count; m++) {
+        total_weight += masks[m].weight;
+        do {
+            masks[m].stride = next_random(&state) % masks[m].keyspace;
+        } while (gcd(masks[m].stride, masks[m].keyspace) != 1);
+        masks[m].offset = next_random(&state) % masks[m].keyspace;
+    }
+
+    char path[512];
+    FILE* out[3];
+    const char* extensions[3] = { "txt", "bin", "truth" };
+    for (int k = 0; k < 3; k++) {
+        snprintf(path, sizeof(path), "%s.%s", prefix, extensions[k]);
+        out[k] = fopen(path, k == 1 ? "wb" : "w");
+        if (!out[k]) {
+            printf("Error: Cannot write %s\n", path);
+            return 1;
+        }
+    }
+
+    // Exactly round(count * fraction) targets come from the keyspace,
+    // spread evenly through the file
+    long long inside_total = (long long)(count * fraction + 0.5);
+    long long inside = 0, outside = 0, repeats = 0;
+    for (long long i = 0; i < count; i++) {
+        char word[MAX_WORD_LENGTH + 1];
+        int from_keyspace = (i + 1) * inside_total / count > inside;
+
+        if (from_keyspace) {
+            double pick = (double)next_random(&state) / 18446744073709551616.0 * total_weight;
+            int m = 0;
+            while (m + 1 < mask_count && pick >= masks[m].weight) {
+                pick -= masks[m].weight;
+                m++;
+            }
+            repeats += !draw_owned(masks, m, word);
+            masks[m].targets++;
+            inside++;
+        } else {
+            if (!draw_outside(masks, mask_count, charset, min_length, max_length, &state, word)) {
+                printf("Error: Every word of length %d-%d over the charset is in the keyspace\n",
+                       min_length, max_length);
+                return 1;
+            }
+            outside++;
+        }
+
+        unsigned char digest[MD5_DIGEST_LENGTH];
+        char hex[MD5_DIGEST_LENGTH * 2 + 1];
+        MD5((unsigned char*)word, strlen(word), digest);
+        for (int b = 0; b < MD5_DIGEST_LENGTH; b++) {
+            sprintf(hex + 2 * b, "%02x", digest[b]);
+        }
+        fprintf(out[0], "%s\n", hex);
+        fwrite(digest, MD5_DIGEST_LENGTH, 1, out[1]);
+        fprintf(out[2], "%s:%s:%d\n", hex, word, from_keyspace);
+    }
+    for (int k = 0; k < 3; k++) {
+        fclose(out[k]);
+    }
+
+    printf("Targets: %lld (%lld in the keyspace, %lld outside), seed %llu\n",
+           count, inside, outside, seed);
+    for (int m = 0; m < mask_count; m++) {
+        printf("  %-22s keyspace %20llu, %llu targets\n",
+               masks[m].text, masks[m].keyspace, masks[m].targets);
+    }
+    if (repeats > 0) {
+        printf("Warning: %lld in-keyspace targets repeat a plaintext (keyspace smaller than the draw, "
+               "or covered by earlier masks)\n", repeats);
+    }
+    printf("Outside: lengths %d-%d over %d characters\n", min_length, max_length, (int)strlen(charset));
+    printf("Files: %s.txt, %s.bin, %s.truth\n", prefix, prefix, prefix);
+    return 0;
+}